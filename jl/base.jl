@@ -78,8 +78,17 @@ isequal(w, v::WeakRef) = isequal(w, v.value)
 finalizer(o, f::Function) = ccall(:jl_gc_add_finalizer, Void, (Any,Any), o, f)
 
 gc() = ccall(:jl_gc_collect, Void, ())
+gc_minor() = ccall(:jl_gc_collect_minor, Void, ())
 gc_enable() = ccall(:jl_gc_enable, Void, ())
 gc_disable() = ccall(:jl_gc_disable, Void, ())
+gc_generational(on::Bool) = ccall(:jl_gc_set_generational, Void, (Int32,), on)
+# collect after allocating mult times the live heap, within [lo, hi] bytes.
+# zero leaves a setting unchanged.
+gc_policy(mult::Real, lo::Integer, hi::Integer) =
+    ccall(:jl_gc_set_policy, Void, (Float64, Uint, Uint),
+          float64(mult), uint(lo), uint(hi))
+# collect fully before the heap grows past this many bytes. 0 for no limit.
+gc_heap_limit(n::Integer) = ccall(:jl_gc_set_heap_limit, Void, (Uint,), uint(n))
 
 current_task() = ccall(:jl_get_current_task, Task, ())
 istaskdone(t::Task) = t.done
@@ -59,3 +59,14 @@ end
 macro task(ex)
     :(Task(()->$ex))
 end
+
+# evaluate a block without array bounds checks
+macro inbounds(blk)
+    v = gensym()
+    quote
+        $expr(:boundscheck, false)
+        $v = $blk
+        $expr(:boundscheck)
+        $v
+    end
+end
@@ -0,0 +1,86 @@
+## short vector bits types ##
+
+# these lower to LLVM vector types inside the v* intrinsics. element access
+# is 1-based; comparisons return a lane mask of the same type, with each
+# lane all ones or all zeros, to be used with blend.
+
+bitstype 128 Float64x2
+bitstype 256 Float64x4
+bitstype 128 Float32x4
+bitstype 256 Float32x8
+bitstype 128 Int32x4
+bitstype 128 Int64x2
+
+for (V, E, n, add, sub, mul, eq, lt, le) =
+    ((:Float64x2, :Float64, 2, :vadd_float, :vsub_float, :vmul_float,
+      :veq_float, :vlt_float, :vle_float),
+     (:Float64x4, :Float64, 4, :vadd_float, :vsub_float, :vmul_float,
+      :veq_float, :vlt_float, :vle_float),
+     (:Float32x4, :Float32, 4, :vadd_float, :vsub_float, :vmul_float,
+      :veq_float, :vlt_float, :vle_float),
+     (:Float32x8, :Float32, 8, :vadd_float, :vsub_float, :vmul_float,
+      :veq_float, :vlt_float, :vle_float),
+     (:Int32x4, :Int32, 4, :vadd_int, :vsub_int, :vmul_int,
+      :veq_int, :vslt_int, :vsle_int),
+     (:Int64x2, :Int64, 2, :vadd_int, :vsub_int, :vmul_int,
+      :veq_int, :vslt_int, :vsle_int))
+    @eval begin
+        eltype(::Type{$V}) = $E
+        eltype(::$V) = $E
+        length(::$V) = $n
+        sizeof(::Type{$V}) = $n*sizeof($E)
+
+        convert(::Type{$V}, x::$E) = box($V, vsplat($E, $n, x))
+        convert(::Type{$V}, x::Real) = convert($V, convert($E, x))
+
+        ref(v::$V, i::Int) = box($E, vextract($E, v, i))
+
+        +(x::$V, y::$V) = box($V, ($add)($E, x, y))
+        -(x::$V, y::$V) = box($V, ($sub)($E, x, y))
+        *(x::$V, y::$V) = box($V, ($mul)($E, x, y))
+
+        .==(x::$V, y::$V) = box($V, ($eq)($E, x, y))
+        .<(x::$V, y::$V)  = box($V, ($lt)($E, x, y))
+        .<=(x::$V, y::$V) = box($V, ($le)($E, x, y))
+
+        blend(m::$V, x::$V, y::$V) = box($V, vselect($E, m, x, y))
+
+        vecload(::Type{$V}, p::Ptr{$E}) = box($V, vload($E, $n, p))
+        function vecload(::Type{$V}, a::Array{$E}, i::Int)
+            if i < 1 || i+$n-1 > numel(a)
+                throw(BoundsError())
+            end
+            vecload($V, pointer(a, i))
+        end
+
+        vecstore(p::Ptr{$E}, v::$V) = vstore($E, p, v)
+        function vecstore(a::Array{$E}, i::Int, v::$V)
+            if i < 1 || i+$n-1 > numel(a)
+                throw(BoundsError())
+            end
+            vecstore(pointer(a, i), v)
+            a
+        end
+
+        function sum(v::$V)
+            s = v[1]
+            for i=2:$n
+                s += v[i]
+            end
+            s
+        end
+
+        function show(v::$V)
+            print($(string(V)), "(")
+            for i=1:$n
+                show(v[i])
+                print(i < $n ? "," : ")")
+            end
+        end
+    end
+end
+
+for (V, E) = ((:Float64x2, :Float64), (:Float64x4, :Float64),
+              (:Float32x4, :Float32), (:Float32x8, :Float32))
+    @eval /(x::$V, y::$V) = box($V, vdiv_float($E, x, y))
+end
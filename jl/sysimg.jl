@@ -23,6 +23,7 @@ include("float.jl")
 include("char.jl")
 include("reduce.jl")
 include("complex.jl")
+include("simd.jl")
 include("rational.jl")
 
 # core data structures (used by type inference)
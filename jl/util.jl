@@ -54,6 +54,212 @@ macro elapsed(ex)
   end
 end
 
+# GC statistics. times are in seconds, sizes in bytes.
+
+type GCStats
+    collections::Int
+    minor_collections::Int
+    finalizers_run::Int
+    allocated::Int
+    live::Int
+    big_live::Int
+    pause_total::Float64
+    pause_max::Float64
+    mark_time::Float64
+    sweep_time::Float64
+    pool_sizes::Array{Int,1}
+    pool_live::Array{Int,1}
+    recent_pauses::Array{Float64,1}
+end
+
+function gc_stats()
+    npools = ccall(:jl_gc_npools, Int32, ())
+    counts = Array(Int, 6)
+    times = Array(Float64, 4)
+    pools = Array(Int, 2*npools)
+    pauses = Array(Float64, ccall(:jl_gc_npauses, Int32, ()))
+    ccall(:jl_gc_get_stats, Void, (Ptr{Int}, Ptr{Float64}, Ptr{Int}, Ptr{Float64}),
+          counts, times, pools, pauses)
+    GCStats(counts[1], counts[2], counts[3], counts[4], counts[5], counts[6],
+            times[1], times[2], times[3], times[4],
+            pools[1:2:end], pools[2:2:end], pauses)
+end
+
+# allocation profiler. while it is on, every nth allocation records its
+# type, size and the Julia functions on the stack.
+
+alloc_profile(n::Integer) = ccall(:jl_gc_alloc_profile, Void, (Uint,), uint(n))
+alloc_profile_clear() = ccall(:jl_gc_alloc_profile_clear, Void, ())
+
+# (type, bytes, backtrace) for each sample. type is nothing for buffers.
+alloc_profile_data() = ccall(:jl_gc_alloc_samples, Any, ())
+
+_jl_alloc_label(T) = is(T,nothing) ? "(buffer)" : string(T)
+
+# samples and sampled bytes by type, most bytes first
+function alloc_profile_print()
+    counts = HashTable()
+    for s = alloc_profile_data()
+        k = _jl_alloc_label(s[1])
+        c = get(counts, k, (0,0))
+        counts[k] = (c[1]+1, c[2]+s[2])
+    end
+    labels = {}
+    bytes = Array(Int, 0)
+    for (k,c) = counts
+        push(labels, k)
+        push(bytes, c[2])
+    end
+    (_, p) = sortperm(-bytes)
+    println("   samples       bytes  type")
+    for i = p
+        c = counts[labels[i]]
+        println(lpad(string(c[1]),10), lpad(string(c[2]),12), "  ", labels[i])
+    end
+end
+
+# one line per distinct stack in the folded format read by flamegraph
+# tools: outermost function first, frames separated by ';', then the
+# allocated type and the number of sampled bytes.
+function alloc_profile_flamegraph()
+    stacks = HashTable()
+    for s = alloc_profile_data()
+        bt = s[3]
+        frames = {}
+        for i = length(bt)-2:-3:1
+            push(frames, strcat(string(bt[i]), " at ", string(bt[i+1]), ":",
+                                string(bt[i+2])))
+        end
+        push(frames, _jl_alloc_label(s[1]))
+        k = join(frames, ";")
+        stacks[k] = get(stacks, k, 0) + s[2]
+    end
+    for (k,n) = stacks
+        println(k, " ", n)
+    end
+end
+
+# dispatch profiler. while it is on, every dynamic call of a generic
+# function is counted, along with method cache misses, specializations
+# created and time spent inferring them.
+
+dispatch_profile(on::Bool) = ccall(:jl_gf_profile, Void, (Int32,), int32(on))
+dispatch_profile_clear() = ccall(:jl_gf_profile_clear, Void, ())
+
+# (name, calls, cache hits, cache misses, specializations, inference time,
+# widened signatures) for each generic function
+dispatch_profile_data() = ccall(:jl_gf_profile_data, Any, ())
+
+# one line per generic function, most calls first
+function dispatch_profile_print()
+    d = dispatch_profile_data()
+    calls = Array(Int, length(d))
+    for i = 1:length(d)
+        calls[i] = d[i][2]
+    end
+    (_, p) = sortperm(-calls)
+    println("     calls      misses   specs  widened  infer(ms)  function")
+    for i = p
+        (name, n, hits, misses, specs, t, widened) = d[i]
+        println(lpad(string(n),10), lpad(string(misses),12),
+                lpad(string(specs),8), lpad(string(widened),9),
+                lpad(string(iround(t*1000)),11),
+                "  ", is(name,nothing) ? "(anonymous)" : string(name))
+    end
+end
+
+# once a method definition has n specializations, further signatures are
+# cached with their Any-declared arguments widened to Any and share code.
+# 0 turns the limit off.
+specialization_limit(n::Integer) =
+    ccall(:jl_set_specialization_limit, Void, (Uint,), uint(n))
+
+# (specializations created, signatures widened, current limit)
+function specialization_stats()
+    counts = Array(Int, 3)
+    ccall(:jl_specialization_stats, Void, (Ptr{Int},), counts)
+    (counts[1], counts[2], counts[3])
+end
+
+# functions that have not been compiled run in the interpreter until their
+# calls plus loop iterations reach n, and are compiled after that.
+# 0 compiles every function on its first call.
+tier_threshold(n::Integer) =
+    ccall(:jl_set_tier_threshold, Void, (Uint32,), uint32(n))
+
+# (calls interpreted, functions compiled after interpretation, threshold)
+function tier_stats()
+    counts = Array(Int, 3)
+    ccall(:jl_tier_stats, Void, (Ptr{Int},), counts)
+    (counts[1], counts[2], counts[3])
+end
+
+# LLVM optimization level for code compiled from now on: 0 and 1 compile
+# fastest, 2 is the default, 3 runs extra loop and redundancy passes.
+optimization_level() = int(ccall(:jl_get_opt_level, Int32, ()))
+optimization_level(n::Integer) = ccall(:jl_set_opt_level, Void, (Int32,), int32(n))
+
+# the optimization level forced on the method of f with argument types
+# types, or -1 if it follows the global level
+optimization_level(f::Function, types::Tuple) =
+    int(ccall(:jl_get_function_opt_level, Int32, (Any, Any), f, types))
+
+# expression for the signature of the method defined by ex, with any static
+# parameters bound to fresh type variables; () for anonymous functions
+function _method_sig(ex)
+    if !(isa(ex,Expr) && (is(ex.head,:function) || is(ex.head,:(=))) &&
+         isa(ex.args[1],Expr) && is(ex.args[1].head,:call))
+        return :(())
+    end
+    call = ex.args[1]
+    types = {}
+    for i = 2:length(call.args)
+        a = call.args[i]
+        isseq = isa(a,Expr) && is(a.head,symbol("..."))
+        if isseq
+            a = a.args[1]
+        end
+        t = (isa(a,Expr) && is(a.head,:(::))) ? a.args[length(a.args)] : :Any
+        push(types, isseq ? expr(symbol("..."), t) : t)
+    end
+    sig = expr(:tuple, types...)
+    if !(isa(call.args[1],Expr) && is(call.args[1].head,:curly))
+        return sig
+    end
+    names = {}
+    tvars = {}
+    for p = call.args[1].args[2:end]
+        if isa(p,Expr) && is(p.head,:comparison)
+            push(names, p.args[1])
+            push(tvars, :(typevar($expr(:quote,p.args[1]), $(p.args[3]))))
+        else
+            push(names, p)
+            push(tvars, :(typevar($expr(:quote,p))))
+        end
+    end
+    expr(:call, expr(:->, expr(:tuple, names...), sig), tvars...)
+end
+
+# compile the method defined by ex at the highest level whatever the global
+# level, e.g. @optimize function kernel(x) ... end
+macro optimize(ex)
+    f = gensym()
+    quote
+        $f = $ex
+        ccall(:jl_set_function_opt_level, Void, (Any, Any, Int32),
+              $f, $(_method_sig(ex)),
+              ccall(:jl_get_max_opt_level, Int32, ()))
+        $f
+    end
+end
+
+# (hits, misses, clears) of the cache of subtype and intersection results
+function type_memo_stats()
+    counts = Array(Int, 3)
+    ccall(:jl_type_memo_stats, Void, (Ptr{Int},), counts)
+    (counts[1], counts[2], counts[3])
+end
+
 function peakflops()
     a = rand(2000,2000)
     t = @elapsed a*a
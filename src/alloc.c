@@ -67,7 +67,7 @@ jl_sym_t *null_sym;    jl_sym_t *body_sym;
 jl_sym_t *macro_sym;   jl_sym_t *method_sym;
 jl_sym_t *enter_sym;   jl_sym_t *leave_sym;
 jl_sym_t *exc_sym;     jl_sym_t *error_sym;
-jl_sym_t *static_typeof_sym;
+jl_sym_t *static_typeof_sym; jl_sym_t *boundscheck_sym;
 jl_sym_t *new_sym;     jl_sym_t *multivalue_sym;
 jl_sym_t *const_sym;   jl_sym_t *thunk_sym;
 jl_sym_t *anonymous_sym;  jl_sym_t *underscore_sym;
@@ -227,6 +227,9 @@ jl_lambda_info_t *jl_new_lambda_info(jl_value_t *ast, jl_tuple_t *sparams)
     li->inferred = jl_false;
     li->inInference = 0;
     li->inCompile = 0;
+    li->interp = 0;
+    li->nticks = 0;
+    li->optlevel = -1;
     li->unspecialized = NULL;
     li->specializations = NULL;
     li->name = anonymous_sym;
@@ -235,71 +238,146 @@ jl_lambda_info_t *jl_new_lambda_info(jl_value_t *ast, jl_tuple_t *sparams)
 
 // symbols --------------------------------------------------------------------
 
-static jl_sym_t *symtab = NULL;
+/*
+  symbols are interned in an open-addressed hash table with linear probing,
+  keyed on the hash computed for each symbol. symbols are never freed, so
+  they are carved out of large malloc'd blocks rather than allocated one
+  at a time.
+*/
+
+static jl_sym_t **symtab = NULL;
+static size_t symtab_sz = 0;  // power of two
+static size_t symtab_n = 0;
+
+#define SYMTAB_INITSZ     4096
+#define SYM_ARENA_BLOCK   65536
 
-static jl_sym_t *mk_symbol(const char *str)
+static char *sym_arena = NULL;
+static size_t sym_arena_left = 0;
+
+static void *sym_alloc(size_t sz)
 {
-    jl_sym_t *sym;
-    size_t len = strlen(str);
+    sz = LLT_ALIGN(sz, 16);
+    if (sz > SYM_ARENA_BLOCK/4)
+        return malloc(sz);
+    if (sz > sym_arena_left) {
+        sym_arena = (char*)malloc(SYM_ARENA_BLOCK);
+        if (sym_arena == NULL) {
+            sym_arena_left = 0;
+            return NULL;
+        }
+        sym_arena_left = SYM_ARENA_BLOCK;
+    }
+    void *p = sym_arena;
+    sym_arena += sz;
+    sym_arena_left -= sz;
+    return p;
+}
 
-    sym = (jl_sym_t*)malloc(sizeof(jl_sym_t)-sizeof(void*) + len + 1);
-    sym->type = (jl_type_t*)jl_sym_type;
-    sym->left = sym->right = NULL;
+static uptrint_t hash_symbol(const char *str, size_t len)
+{
 #ifdef __LP64__
-    sym->hash = memhash(str, len)^0xAAAAAAAAAAAAAAAAL;
+    return memhash(str, len)^0xAAAAAAAAAAAAAAAAL;
 #else
-    sym->hash = memhash32(str, len)^0xAAAAAAAA;
+    return memhash32(str, len)^0xAAAAAAAA;
 #endif
-    strcpy(&sym->name[0], str);
+}
+
+static jl_sym_t *mk_symbol(const char *str, size_t len, uptrint_t hash)
+{
+    jl_sym_t *sym;
+
+    sym = (jl_sym_t*)sym_alloc(sizeof(jl_sym_t)-sizeof(void*) + len + 1);
+    if (sym == NULL)
+        jl_raise(jl_memory_exception);
+    sym->type = (jl_type_t*)jl_sym_type;
+    sym->hash = hash;
+    memcpy(&sym->name[0], str, len);
+    sym->name[len] = '\0';
     return sym;
 }
 
-static void unmark_symbols_(jl_sym_t *root)
+void jl_unmark_symbols(void)
 {
-    while (root != NULL) {
-        root->type = (jl_type_t*)(((uptrint_t)root->type)&~1UL);
-        unmark_symbols_(root->left);
-        root = root->right;
+    size_t i;
+    for(i=0; i < symtab_sz; i++) {
+        jl_sym_t *sym = symtab[i];
+        if (sym != NULL)
+            sym->type = (jl_type_t*)(((uptrint_t)sym->type)&~1UL);
     }
 }
 
-void jl_unmark_symbols(void) { unmark_symbols_(symtab); }
+static jl_sym_t **symtab_lookup(jl_sym_t **tab, size_t sz,
+                                const char *str, size_t len, uptrint_t hash)
+{
+    size_t mask = sz-1;
+    size_t i = hash & mask;
+    while (1) {
+        jl_sym_t *sym = tab[i];
+        if (sym == NULL ||
+            (sym->hash == hash && strncmp(sym->name, str, len) == 0 &&
+             sym->name[len] == '\0'))
+            return &tab[i];
+        i = (i+1) & mask;
+    }
+}
 
-static jl_sym_t **symtab_lookup(jl_sym_t **ptree, const char *str)
+static void symtab_grow(void)
 {
-    int x;
+    size_t newsz = symtab_sz ? symtab_sz*2 : SYMTAB_INITSZ;
+    jl_sym_t **newtab = (jl_sym_t**)calloc(newsz, sizeof(jl_sym_t*));
+    if (newtab == NULL)
+        jl_raise(jl_memory_exception);
+    size_t i;
+    for(i=0; i < symtab_sz; i++) {
+        jl_sym_t *sym = symtab[i];
+        if (sym != NULL) {
+            size_t j = sym->hash & (newsz-1);
+            while (newtab[j] != NULL)
+                j = (j+1) & (newsz-1);
+            newtab[j] = sym;
+        }
+    }
+    free(symtab);
+    symtab = newtab;
+    symtab_sz = newsz;
+}
 
-    while(*ptree != NULL) {
-        x = strcmp(str, (*ptree)->name);
-        if (x == 0)
-            return ptree;
-        if (x < 0)
-            ptree = &(*ptree)->left;
-        else
-            ptree = &(*ptree)->right;
+static jl_sym_t *_jl_symbol(const char *str, size_t len)
+{
+    // keep the load factor at most 1/2
+    if ((symtab_n+1)*2 > symtab_sz)
+        symtab_grow();
+    uptrint_t hash = hash_symbol(str, len);
+    jl_sym_t **slot = symtab_lookup(symtab, symtab_sz, str, len, hash);
+    if (*slot == NULL) {
+        *slot = mk_symbol(str, len, hash);
+        symtab_n++;
     }
-    return ptree;
+    return *slot;
 }
 
 jl_sym_t *jl_symbol(const char *str)
 {
-    jl_sym_t **pnode;
-
-    pnode = symtab_lookup(&symtab, str);
-    if (*pnode == NULL)
-        *pnode = mk_symbol(str);
-    return *pnode;
+    return _jl_symbol(str, strlen(str));
 }
 
 DLLEXPORT jl_sym_t *jl_symbol_n(const char *str, int32_t len)
 {
-    char name[len+1];
-    memcpy(name, str, len);
-    name[len] = '\0';
-    return jl_symbol(name);
+    // symbol names end at the first NUL
+    const char *z = (const char*)memchr(str, 0, len);
+    if (z != NULL)
+        len = z - str;
+    return _jl_symbol(str, len);
 }
 
-DLLEXPORT jl_sym_t *jl_get_root_symbol() { return symtab; }
+// the slots of the symbol table, for enumerating all symbols. empty
+// slots are NULL.
+DLLEXPORT jl_sym_t **jl_get_symtab(size_t *psz)
+{
+    *psz = symtab_sz;
+    return symtab;
+}
 
 static uint32_t gs_ctr = 0;  // TODO: per-thread
 uint32_t jl_get_gs_ctr(void) { return gs_ctr; }
@@ -322,7 +400,7 @@ jl_typename_t *jl_new_typename(jl_sym_t *name)
     jl_typename_t *tn=(jl_typename_t*)newobj((jl_type_t*)jl_typename_type, 3);
     tn->name = name;
     tn->primary = NULL;
-    tn->cache = jl_null;
+    tn->cache = NULL;
     return tn;
 }
 
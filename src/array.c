@@ -56,9 +56,7 @@ static jl_array_t *_new_array(jl_type_t *atype,
         a->data = NULL;
         a->length = 0;
         a->reshaped = 0;
-        data = allocb(tot);
-        if (!isunboxed)
-            memset(data, 0, tot);
+        data = isunboxed ? allocb(tot) : allocb_zeroed(tot);
         JL_GC_POP();
     }
 
@@ -309,6 +307,7 @@ void jl_arrayset(jl_array_t *a, size_t i, jl_value_t *rhs)
     }
     else {
         ((jl_value_t**)a->data)[i] = rhs;
+        jl_gc_wb_array(a, rhs);
     }
 }
 
@@ -333,9 +332,7 @@ static void *array_new_buffer(jl_array_t *a, size_t newlen)
         nbytes++;
     }
     int isunboxed = jl_is_bits_type(jl_tparam0(jl_typeof(a)));
-    char *newdata = allocb(nbytes);
-    if (!isunboxed)
-        memset(newdata, 0, nbytes);
+    char *newdata = isunboxed ? allocb(nbytes) : allocb_zeroed(nbytes);
     if (a->elsize == 1) newdata[nbytes-1] = '\0';
     return newdata;
 }
@@ -358,6 +355,7 @@ void jl_array_grow_end(jl_array_t *a, size_t inc)
         }
         a->maxsize = newlen;
         a->data = newdata;
+        jl_gc_wb_back(a);
     }
     a->length += inc; a->nrows += inc;
 }
@@ -402,6 +400,7 @@ void jl_array_grow_beg(jl_array_t *a, size_t inc)
         }
         memmove(&newdata[nb], a->data, anb);
         a->data = newdata;
+        jl_gc_wb_back(a);
     }
     a->length += inc; a->nrows += inc;
 }
@@ -445,4 +444,5 @@ void jl_cell_1d_push(jl_array_t *a, jl_value_t *item)
     assert(jl_typeis(a, jl_array_any_type));
     jl_array_grow_end(a, 1);
     jl_cellset(a, a->length-1, item);
+    jl_gc_wb_array(a, item);
 }
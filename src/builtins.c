@@ -632,6 +632,7 @@ JL_CALLABLE(jl_f_set_field)
         jl_type_error("setfield", ft, args[2]);
     }
     ((jl_value_t**)v)[1+i] = args[2];
+    jl_gc_wb(v, args[2]);
     return args[2];
 }
 
@@ -873,6 +874,9 @@ JL_CALLABLE(jl_trampoline)
 {
     assert(jl_is_func(F));
     assert(((jl_function_t*)F)->linfo != NULL);
+    jl_value_t *result;
+    if (jl_tiered_apply((jl_function_t*)F, args, nargs, &result))
+        return result;
     /* // to run inference on all thunks. slows down loading files.
     if (F->linfo->inferred == jl_false) {
         if (!jl_in_inference) {
@@ -945,6 +949,7 @@ JL_CALLABLE(jl_f_new_struct_fields)
 
     check_supertype(super, st->name->name->name);
     st->super = (jl_tag_type_t*)super;
+    jl_type_memo_clear();
     assert(jl_is_tag_type(super));
 
     st->types = ftypes;
@@ -952,7 +957,7 @@ JL_CALLABLE(jl_f_new_struct_fields)
     if (st->parameters->length > 0) {
         // once the full structure is built, use instantiate_type to walk it
         // and tie up self-references.
-        st->name->cache = jl_null;
+        st->name->cache = NULL;
         jl_reinstantiate_inner_types((jl_tag_type_t*)st);
     }
 
@@ -987,8 +992,9 @@ JL_CALLABLE(jl_f_new_tag_type_super)
     jl_value_t *super = args[1];
     check_supertype(super, tt->name->name->name);
     tt->super = (jl_tag_type_t*)super;
+    jl_type_memo_clear();
     if (tt->parameters->length > 0) {
-        tt->name->cache = jl_null;
+        tt->name->cache = NULL;
         jl_reinstantiate_inner_types((jl_tag_type_t*)tt);
     }
     return (jl_value_t*)jl_nothing;
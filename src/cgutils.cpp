@@ -150,6 +150,36 @@ static Value *emit_bounds_check(Value *i, Value *len, const std::string &msg,
     return im1;
 }
 
+// write barrier for a reference just stored into parent
+static void emit_write_barrier_call(Function *wbfunc, Value *parent,
+                                   jl_codectx_t *ctx)
+{
+#ifdef JL_GC_MARKSWEEP
+    Value *gen = builder.CreateICmpNE(builder.CreateLoad(jlgcgen_var, false),
+                                      ConstantInt::get(T_int32, 0));
+    BasicBlock *wbBB = BasicBlock::Create(getGlobalContext(),"wb",ctx->f);
+    BasicBlock *contBB = BasicBlock::Create(getGlobalContext(),"wbcont");
+    builder.CreateCondBr(gen, wbBB, contBB);
+    builder.SetInsertPoint(wbBB);
+    builder.CreateCall(wbfunc, parent);
+    builder.CreateBr(contBB);
+    ctx->f->getBasicBlockList().push_back(contBB);
+    builder.SetInsertPoint(contBB);
+#endif
+}
+
+static void emit_write_barrier(Value *parent, jl_codectx_t *ctx)
+{
+    emit_write_barrier_call(jlgcwb_func, parent, ctx);
+}
+
+// for stores into array elements. a reshaped array's elements are scanned
+// through the array that owns its buffer, so the barrier goes there.
+static void emit_array_write_barrier(Value *ary, jl_codectx_t *ctx)
+{
+    emit_write_barrier_call(jlgcwbarray_func, ary, ctx);
+}
+
 static void emit_func_check(Value *x, jl_codectx_t *ctx)
 {
     Value *istype1 =
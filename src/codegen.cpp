@@ -18,6 +18,7 @@
 #include <string>
 #include <sstream>
 #include <map>
+#include <set>
 #include <vector>
 #ifdef DEBUG
 #undef NDEBUG
@@ -40,7 +41,8 @@ static Module *jl_Module;
 static ExecutionEngine *jl_ExecutionEngine;
 static DIBuilder *dbuilder;
 static std::map<int, std::string> argNumberStrings;
-static FunctionPassManager *FPM;
+static FunctionPassManager *FPMs[JL_MAX_OPT_LEVEL+1];
+static int jl_opt_level = 2;
 
 // types
 static Type *jl_value_llvmt;
@@ -83,8 +85,10 @@ static GlobalVariable *jlnull_var;
 static GlobalVariable *jlfloat32temp_var;
 #ifdef JL_GC_MARKSWEEP
 static GlobalVariable *jlpgcstack_var;
+static GlobalVariable *jlgcgen_var;
 #endif
 static GlobalVariable *jlexc_var;
+static GlobalVariable *jlworld_var;
 
 // important functions
 static Function *jlnew_func;
@@ -95,15 +99,21 @@ static Function *jldiverror_func;
 static Function *jltypeerror_func;
 static Function *jlcheckassign_func;
 static Function *jldeclareconst_func;
+static Function *jlresolveglobal_func;
 static Function *jltuple_func;
 static Function *jlntuple_func;
 static Function *jlapplygeneric_func;
+static Function *jlapplygenericic_func;
 static Function *jlbox_func;
 static Function *jlclosure_func;
 static Function *jlmethod_func;
 static Function *jlenter_func;
 static Function *jlleave_func;
 static Function *jlallocobj_func;
+#ifdef JL_GC_MARKSWEEP
+static Function *jlgcwb_func;
+static Function *jlgcwbarray_func;
+#endif
 static Function *setjmp_func;
 static Function *box_int8_func;
 static Function *box_uint8_func;
@@ -148,7 +158,8 @@ static Function *to_function(jl_lambda_info_t *li)
     nested_compile = true;
     emit_function(li, f);
     nested_compile = last_n_c;
-    FPM->run(*f);
+    int level = li->optlevel >= 0 ? li->optlevel : jl_opt_level;
+    FPMs[level]->run(*f);
     //n_compile++;
     // print out the function's LLVM code
     //ios_printf(ios_stderr, "%s:%d\n",
@@ -199,10 +210,13 @@ typedef struct {
     std::map<std::string, bool> *isAssigned;
     std::map<std::string, bool> *isCaptured;
     std::map<std::string, bool> *escapes;
+    std::map<std::string, int> *stackTuples;
     std::map<std::string, jl_value_t*> *declTypes;
     std::map<int, BasicBlock*> *labels;
     std::map<int, Value*> *savestates;
     std::map<int, Value*> *jmpbufs;
+    std::set<jl_value_t*> *uncheckedRefs;
+    int inbounds;      // depth of (boundscheck false) regions
     jl_module_t *module;
     jl_expr_t *ast;
     jl_tuple_t *sp;
@@ -345,6 +359,10 @@ static void max_arg_depth(jl_value_t *expr, int32_t *max, int32_t *sp,
             }
             (*sp) = lastsp;
         }
+        else if (e->head == assign_sym) {
+            // storing to a variable does not make it escape
+            max_arg_depth(jl_exprarg(e,1), max, sp, esc, ctx);
+        }
         else if (e->head == method_sym) {
             max_arg_depth(jl_exprarg(e,1), max, sp, esc, ctx);
             (*sp)++;
@@ -378,6 +396,380 @@ static void max_arg_depth(jl_value_t *expr, int32_t *max, int32_t *sp,
     }
 }
 
+// --- stack-allocated tuples ---
+// a local that is only ever assigned calls to tuple with the same number
+// of arguments, and does not escape (it is only passed to tuplelen and
+// tupleref), keeps its elements in consecutive gc frame slots instead of
+// a heap-allocated tuple. the slots are roots, so the elements stay alive.
+
+#define MAX_STACK_TUPLE 8
+
+// number of arguments if ex is a call to the tuple builtin, else 0
+static int tuple_call_nargs(jl_value_t *ex, jl_codectx_t *ctx)
+{
+    if (!jl_is_expr(ex))
+        return 0;
+    jl_expr_t *e = (jl_expr_t*)ex;
+    if (e->head != call_sym && e->head != call1_sym)
+        return 0;
+    jl_value_t *f = jl_exprarg(e,0);
+    if (jl_is_symbolnode(f))
+        f = (jl_value_t*)jl_symbolnode_sym(f);
+    jl_binding_t *b = NULL;
+    // runs before local variables are set up, so check for a local of
+    // the same name with declTypes instead of is_global
+    if (jl_is_symbol(f) &&
+        ctx->declTypes->find(((jl_sym_t*)f)->name) == ctx->declTypes->end())
+        b = jl_get_binding(ctx->module, (jl_sym_t*)f);
+    else if (jl_is_topnode(f))
+        b = jl_get_binding(ctx->module, (jl_sym_t*)jl_fieldref(f,0));
+    if (b == NULL || !b->constp || b->value == NULL ||
+        !jl_is_func(b->value) ||
+        ((jl_function_t*)b->value)->fptr != &jl_f_tuple)
+        return 0;
+    int n = e->args->length-1;
+    return (n <= MAX_STACK_TUPLE ? n : 0);
+}
+
+// record the tuple length of every assignment to a candidate variable.
+// -1 means no assignment seen yet, 0 that the variable does not qualify.
+static void find_stack_tuples(jl_value_t *expr, jl_codectx_t *ctx)
+{
+    if (!jl_is_expr(expr))
+        return;
+    jl_expr_t *e = (jl_expr_t*)expr;
+    if (e->head == assign_sym) {
+        jl_value_t *l = jl_exprarg(e,0);
+        if (jl_is_symbolnode(l))
+            l = (jl_value_t*)jl_symbolnode_sym(l);
+        std::map<std::string,int>::iterator it = ctx->stackTuples->end();
+        if (jl_is_symbol(l))
+            it = ctx->stackTuples->find(((jl_sym_t*)l)->name);
+        if (it != ctx->stackTuples->end()) {
+            int n = tuple_call_nargs(jl_exprarg(e,1), ctx);
+            if ((*it).second == -1 || (*it).second == n)
+                (*it).second = n;
+            else
+                (*it).second = 0;
+        }
+    }
+    size_t i;
+    for(i=0; i < e->args->length; i++)
+        find_stack_tuples(jl_exprarg(e,i), ctx);
+}
+
+static int stack_tuple_len(jl_value_t *e, jl_codectx_t *ctx)
+{
+    if (jl_is_symbolnode(e))
+        e = (jl_value_t*)jl_symbolnode_sym(e);
+    if (!jl_is_symbol(e))
+        return 0;
+    std::map<std::string,int>::iterator it =
+        ctx->stackTuples->find(((jl_sym_t*)e)->name);
+    if (it == ctx->stackTuples->end())
+        return 0;
+    return (*it).second;
+}
+
+// --- bounds check elimination ---
+// "for i = k:length(a)" with a literal k >= 1 lowers to
+//     cnt = k; lim = length(a)
+//     top: gotoifnot cnt <= lim, exit
+//     i = cnt; body; cnt = cnt+1; goto top
+//     exit:
+// so the body runs with 1 <= i <= length(a). if the loop makes no call
+// that could run arbitrary code (and so resize a), and rebinds neither
+// a nor i, then arrayref(a,i) and arrayset(a,i,x) inside it cannot fail.
+// the limit must be the builtin arraylen, which is what length(a) becomes
+// once inlined for an Array. a length method of the user's could return
+// anything.
+
+static jl_sym_t *var_sym(jl_value_t *e)
+{
+    if (jl_is_symbolnode(e))
+        return jl_symbolnode_sym(e);
+    if (jl_is_symbol(e))
+        return (jl_sym_t*)e;
+    return NULL;
+}
+
+// value of a constant call head, or NULL. runs before local variables
+// are set up, so locals are recognized with declTypes.
+static jl_value_t *static_call_head(jl_value_t *ex, jl_codectx_t *ctx)
+{
+    if (!jl_is_expr(ex) || (((jl_expr_t*)ex)->head != call_sym &&
+                            ((jl_expr_t*)ex)->head != call1_sym))
+        return NULL;
+    jl_value_t *f = jl_exprarg(ex,0);
+    if (jl_is_symbolnode(f))
+        f = (jl_value_t*)jl_symbolnode_sym(f);
+    jl_binding_t *b = NULL;
+    if (jl_is_symbol(f) &&
+        ctx->declTypes->find(((jl_sym_t*)f)->name) == ctx->declTypes->end())
+        b = jl_get_binding(ctx->module, (jl_sym_t*)f);
+    else if (jl_is_topnode(f))
+        b = jl_get_binding(ctx->module, (jl_sym_t*)jl_fieldref(f,0));
+    if (b == NULL || !b->constp)
+        return NULL;
+    return b->value;
+}
+
+static bool is_builtin_call(jl_value_t *ex, jl_fptr_t fptr, jl_codectx_t *ctx)
+{
+    jl_value_t *f = static_call_head(ex, ctx);
+    return (f != NULL && jl_is_func(f) && ((jl_function_t*)f)->fptr == fptr);
+}
+
+static bool is_named_call(jl_value_t *ex, const char *name, jl_codectx_t *ctx)
+{
+    if (static_call_head(ex, ctx) == NULL)
+        return false;
+    jl_value_t *f = jl_exprarg(ex,0);
+    if (jl_is_symbolnode(f))
+        f = (jl_value_t*)jl_symbolnode_sym(f);
+    if (jl_is_topnode(f))
+        f = jl_fieldref(f,0);
+    return (jl_is_symbol(f) && !strcmp(((jl_sym_t*)f)->name, name));
+}
+
+// calls that cannot reach user code
+static bool benign_call(jl_value_t *ex, jl_codectx_t *ctx)
+{
+    jl_value_t *f = static_call_head(ex, ctx);
+    if (f == NULL)
+        return false;
+    if (jl_typeis(f, jl_intrinsic_type))
+        return (jl_unbox_int32(f) != JL_I::ccall);
+    if (!jl_is_func(f))
+        return false;
+    jl_fptr_t fp = ((jl_function_t*)f)->fptr;
+    return (fp == &jl_f_arrayref || fp == &jl_f_arrayset ||
+            fp == &jl_f_arraylen || fp == &jl_f_arraysize ||
+            fp == &jl_f_tuple || fp == &jl_f_tupleref ||
+            fp == &jl_f_tuplelen || fp == &jl_f_get_field ||
+            fp == &jl_f_is || fp == &jl_f_isa || fp == &jl_f_typeof ||
+            fp == &jl_f_typeassert);
+}
+
+static bool only_benign_calls(jl_value_t *ex, jl_codectx_t *ctx)
+{
+    if (!jl_is_expr(ex))
+        return true;
+    jl_expr_t *e = (jl_expr_t*)ex;
+    if ((e->head == call_sym || e->head == call1_sym) && !benign_call(ex, ctx))
+        return false;
+    size_t i;
+    for(i=0; i < e->args->length; i++) {
+        if (!only_benign_calls(jl_exprarg(e,i), ctx))
+            return false;
+    }
+    return true;
+}
+
+static jl_sym_t *assigned_sym(jl_value_t *st)
+{
+    if (jl_is_expr(st) && ((jl_expr_t*)st)->head == assign_sym)
+        return var_sym(jl_exprarg(st,0));
+    return NULL;
+}
+
+static bool mentions(jl_value_t *ex, jl_sym_t *s)
+{
+    if (var_sym(ex) == s)
+        return true;
+    if (!jl_is_expr(ex))
+        return false;
+    size_t i;
+    for(i=0; i < ((jl_expr_t*)ex)->args->length; i++) {
+        if (mentions(jl_exprarg(ex,i), s))
+            return true;
+    }
+    return false;
+}
+
+static bool mentions_one(jl_value_t *ex)
+{
+    if (jl_is_long(ex))
+        return jl_unbox_long(ex) == 1;
+    if (!jl_is_expr(ex))
+        return false;
+    size_t i;
+    for(i=0; i < ((jl_expr_t*)ex)->args->length; i++) {
+        if (mentions_one(jl_exprarg(ex,i)))
+            return true;
+    }
+    return false;
+}
+
+// x itself, after removing an unbox that inlining may have added
+static jl_sym_t *compared_sym(jl_value_t *ex, jl_codectx_t *ctx)
+{
+    jl_value_t *f = static_call_head(ex, ctx);
+    if (f != NULL && jl_typeis(f, jl_intrinsic_type)) {
+        int fi = jl_unbox_int32(f);
+        if (fi == JL_I::unbox32 || fi == JL_I::unbox64 || fi == JL_I::unbox)
+            ex = jl_exprarg(ex, ((jl_expr_t*)ex)->args->length-1);
+    }
+    return var_sym(ex);
+}
+
+static int label_target(jl_value_t *st)
+{
+    if (jl_is_gotonode(st))
+        return jl_gotonode_label(st);
+    if (jl_is_expr(st) && (((jl_expr_t*)st)->head == goto_ifnot_sym ||
+                           ((jl_expr_t*)st)->head == enter_sym))
+        return jl_unbox_long(jl_exprarg(st, ((jl_expr_t*)st)->args->length-1));
+    return -1;
+}
+
+static void collect_unchecked_refs(jl_value_t *ex, jl_sym_t *a, jl_sym_t *i,
+                                   jl_codectx_t *ctx)
+{
+    if (!jl_is_expr(ex))
+        return;
+    jl_expr_t *e = (jl_expr_t*)ex;
+    size_t n = e->args->length;
+    if ((n == 3 && is_builtin_call(ex, &jl_f_arrayref, ctx)) ||
+        (n == 4 && is_builtin_call(ex, &jl_f_arrayset, ctx))) {
+        if (var_sym(jl_exprarg(e,1)) == a && var_sym(jl_exprarg(e,2)) == i)
+            ctx->uncheckedRefs->insert(ex);
+    }
+    size_t k;
+    for(k=0; k < n; k++)
+        collect_unchecked_refs(jl_exprarg(e,k), a, i, ctx);
+}
+
+static void find_unchecked_refs(jl_array_t *stmts, jl_codectx_t *ctx)
+{
+    size_t n = stmts->length, h, k;
+    for(h=1; h+1 < n; h++) {
+        jl_value_t *test = jl_cellref(stmts,h);
+        jl_value_t *toplbl = jl_cellref(stmts,h-1);
+        if (!jl_is_expr(test) || ((jl_expr_t*)test)->head != goto_ifnot_sym ||
+            !jl_is_labelnode(toplbl))
+            continue;
+        long top = jl_labelnode_label(toplbl);
+        long exitl = jl_unbox_long(jl_exprarg(test,1));
+        // the loop is the range up to the last jump back to the top,
+        // which must fall through to the exit label
+        size_t end = 0;
+        for(k=h+1; k+1 < n; k++) {
+            if (jl_is_gotonode(jl_cellref(stmts,k)) &&
+                jl_gotonode_label(jl_cellref(stmts,k)) == top)
+                end = k;
+        }
+        if (end == 0 || !jl_is_labelnode(jl_cellref(stmts,end+1)) ||
+            jl_labelnode_label(jl_cellref(stmts,end+1)) != exitl)
+            continue;
+        // cnt <= lim
+        jl_value_t *cond = jl_exprarg(test,0);
+        if (!jl_is_expr(cond) || ((jl_expr_t*)cond)->args->length != 3)
+            continue;
+        jl_value_t *cf = static_call_head(cond, ctx);
+        if (!is_named_call(cond, "<=", ctx) &&
+            !(cf != NULL && jl_typeis(cf, jl_intrinsic_type) &&
+              jl_unbox_int32(cf) == JL_I::sle_int))
+            continue;
+        jl_sym_t *cnt = compared_sym(jl_exprarg(cond,1), ctx);
+        jl_sym_t *lim = compared_sym(jl_exprarg(cond,2), ctx);
+        if (cnt == NULL || lim == NULL ||
+            cnt->name[0] != '#' || lim->name[0] != '#')
+            continue;
+        // i = cnt
+        jl_value_t *iasgn = jl_cellref(stmts,h+1);
+        jl_sym_t *i = assigned_sym(iasgn);
+        if (i == NULL || var_sym(jl_exprarg(iasgn,1)) != cnt)
+            continue;
+        // cnt is set to a literal >= 1 before the loop and incremented
+        // once inside it; lim is set once, to arraylen(a)
+        bool ok = true;
+        jl_sym_t *a = NULL;
+        size_t limdef = 0;
+        int ninit = 0, ninc = 0, nlim = 0;
+        for(k=0; k < n && ok; k++) {
+            jl_value_t *st = jl_cellref(stmts,k);
+            jl_sym_t *s = assigned_sym(st);
+            if (s == NULL)
+                continue;
+            jl_value_t *rhs = jl_exprarg(st,1);
+            if (s == cnt && k < h) {
+                ninit++;
+                ok = jl_is_long(rhs) && jl_unbox_long(rhs) >= 1;
+            }
+            else if (s == cnt && k <= end) {
+                ninc++;
+                ok = mentions(rhs, cnt) && mentions_one(rhs);
+            }
+            else if (s == lim && k < h) {
+                nlim++;
+                limdef = k;
+                ok = (jl_is_expr(rhs) &&
+                      ((jl_expr_t*)rhs)->args->length == 2 &&
+                      is_builtin_call(rhs, &jl_f_arraylen, ctx));
+                if (ok)
+                    a = var_sym(jl_exprarg(rhs,1));
+            }
+            else if (s == cnt || s == lim) {
+                ok = false;
+            }
+        }
+        if (!ok || ninit != 1 || ninc != 1 || nlim != 1 || a == NULL ||
+            a == i || (*ctx->isCaptured)[a->name] ||
+            (*ctx->isCaptured)[i->name])
+            continue;
+        for(k=limdef+1; k <= end && ok; k++) {
+            jl_value_t *st = jl_cellref(stmts,k);
+            jl_sym_t *s = assigned_sym(st);
+            if (s == a || (s == i && k != h+1) ||
+                !only_benign_calls(st, ctx))
+                ok = false;
+        }
+        // nothing may jump into the middle of the loop
+        for(k=0; k < n && ok; k++) {
+            if (k >= h-1 && k <= end+1)
+                continue;
+            int tgt = label_target(jl_cellref(stmts,k));
+            if (tgt < 0)
+                continue;
+            size_t j;
+            for(j=h; j <= end; j++) {
+                jl_value_t *l = jl_cellref(stmts,j);
+                if (jl_is_labelnode(l) && jl_labelnode_label(l) == tgt)
+                    ok = false;
+            }
+        }
+        if (!ok)
+            continue;
+        for(k=h+2; k < end; k++)
+            collect_unchecked_refs(jl_cellref(stmts,k), a, i, ctx);
+    }
+}
+
+// index for an array access, checked unless inside @inbounds or proven
+// in range above
+static Value *emit_array_index(Value *idx, Value *alen, jl_value_t *expr,
+                               const std::string &msg, jl_codectx_t *ctx)
+{
+    if (ctx->inbounds > 0 || ctx->uncheckedRefs->count(expr))
+        return builder.CreateSub(idx, ConstantInt::get(T_size, 1));
+    return emit_bounds_check(idx, alen, msg, ctx);
+}
+
+static Value *emit_checked_var(Value *bp, const char *name, jl_codectx_t *ctx);
+
+// slots of a stack tuple. the elements are assigned together, so the first
+// one tells whether the variable is defined.
+static Value *emit_stack_tuple_slots(jl_value_t *e, jl_codectx_t *ctx)
+{
+    if (jl_is_symbolnode(e))
+        e = (jl_value_t*)jl_symbolnode_sym(e);
+    jl_sym_t *s = (jl_sym_t*)e;
+    Value *bp = (*ctx->vars)[s->name];
+    emit_checked_var(bp, s->name, ctx);
+    return bp;
+}
+
 static void make_gcroot(Value *v, jl_codectx_t *ctx)
 {
     assert(ctx->argDepth < ctx->argSpace);
@@ -476,6 +868,39 @@ static jl_tuple_t *call_arg_types(jl_value_t **args, size_t n, jl_codectx_t *ctx
 }
 
 extern "C" jl_function_t *jl_get_specialization(jl_function_t *f, jl_tuple_t *types);
+extern "C" jl_function_t *jl_get_invoke_specialization(jl_function_t *gf,
+                                                       jl_tuple_t *types,
+                                                       jl_tuple_t *argtypes);
+
+// the signature argument of an invoke() call, if it is known statically
+static jl_tuple_t *static_invoke_types(jl_value_t *ex, jl_codectx_t *ctx)
+{
+    if (!is_constant(ex, ctx)) {
+        if (!jl_is_expr(ex))
+            return NULL;
+        jl_array_t *eargs = ((jl_expr_t*)ex)->args;
+        for(size_t i=0; i < jl_array_len(eargs); i++) {
+            if (!is_constant(jl_cellref(eargs,i), ctx))
+                return NULL;
+        }
+    }
+    jl_value_t *ty = expr_type(ex, ctx);
+    if (!jl_is_tuple(ty))
+        return NULL;
+    jl_tuple_t *tt = (jl_tuple_t*)ty;
+    jl_tuple_t *t = jl_alloc_tuple(tt->length);
+    JL_GC_PUSH(&t);
+    for(size_t i=0; i < tt->length; i++) {
+        jl_value_t *e = jl_tupleref(tt,i);
+        if (!jl_is_type_type(e) || jl_is_typevar(jl_tparam0(e))) {
+            t = NULL;
+            break;
+        }
+        jl_tupleset(t, i, jl_tparam0(e));
+    }
+    JL_GC_POP();
+    return t;
+}
 
 static Value *emit_known_call(jl_value_t *ff, jl_value_t **args, size_t nargs,
                               jl_codectx_t *ctx,
@@ -590,6 +1015,12 @@ static Value *emit_known_call(jl_value_t *ff, jl_value_t **args, size_t nargs,
     else if (f->fptr == &jl_f_tuplelen && nargs==1) {
         jl_value_t *aty = expr_type(args[1], ctx); rt1 = aty;
         if (jl_is_tuple(aty)) {
+            int ntup = stack_tuple_len(args[1], ctx);
+            if (ntup > 0) {
+                emit_stack_tuple_slots(args[1], ctx);
+                JL_GC_POP();
+                return ConstantInt::get(T_size, ntup);
+            }
             if (symbol_eq(args[1], ctx->vaName) &&
                 !(*ctx->isAssigned)[ctx->vaName->name]) {
                 JL_GC_POP();
@@ -606,6 +1037,16 @@ static Value *emit_known_call(jl_value_t *ff, jl_value_t **args, size_t nargs,
         jl_value_t *tty = expr_type(args[1], ctx); rt1 = tty;
         jl_value_t *ity = expr_type(args[2], ctx); rt2 = ity;
         if (jl_is_tuple(tty) && ity==(jl_value_t*)jl_long_type) {
+            int ntup = stack_tuple_len(args[1], ctx);
+            if (ntup > 0) {
+                Value *slots = emit_stack_tuple_slots(args[1], ctx);
+                Value *idx = emit_unbox(T_size, T_psize,
+                                        emit_unboxed(args[2], ctx));
+                idx = emit_bounds_check(idx, ConstantInt::get(T_size, ntup),
+                                        "tupleref: index out of range", ctx);
+                JL_GC_POP();
+                return builder.CreateLoad(builder.CreateGEP(slots, idx), false);
+            }
             if (ctx->vaStack && symbol_eq(args[1], ctx->vaName)) {
                 Value *valen = emit_n_varargs(ctx);
                 Value *idx = emit_unbox(T_size, T_psize,
@@ -776,8 +1217,8 @@ static Value *emit_known_call(jl_value_t *ff, jl_value_t **args, size_t nargs,
                 Value *idx = emit_unbox(T_size, T_psize,
                                         emit_unboxed(args[2], ctx));
                 Value *im1 =
-                    emit_bounds_check(idx, alen,
-                                      "arrayref: index out of range", ctx);
+                    emit_array_index(idx, alen, expr,
+                                     "arrayref: index out of range", ctx);
                 Value *elt=builder.CreateLoad(builder.CreateGEP(data, im1),
                                               false);
                 if (ety == (jl_value_t*)jl_any_type) {
@@ -820,9 +1261,11 @@ static Value *emit_known_call(jl_value_t *ff, jl_value_t **args, size_t nargs,
                     rhs = boxed(emit_expr(args[3], ctx, true));
                 }
                 Value *im1 =
-                    emit_bounds_check(idx, alen,
-                                      "arrayset: index out of range", ctx);
+                    emit_array_index(idx, alen, expr,
+                                     "arrayset: index out of range", ctx);
                 builder.CreateStore(rhs, builder.CreateGEP(data, im1));
+                if (!jl_is_bits_type(ety))
+                    emit_array_write_barrier(ary, ctx);
                 JL_GC_POP();
                 return ary;
             }
@@ -860,6 +1303,7 @@ static Value *emit_known_call(jl_value_t *ff, jl_value_t **args, size_t nargs,
                     Value *rhs = boxed(emit_expr(args[3], ctx, true));
                     Value *addr = emit_nthptr_addr(strct, offs+1);
                     builder.CreateStore(rhs, addr);
+                    emit_write_barrier(strct, ctx);
                     JL_GC_POP();
                     return rhs;
                 }
@@ -883,11 +1327,106 @@ static Value *emit_known_call(jl_value_t *ff, jl_value_t **args, size_t nargs,
             }
         }
     }
+    else if (f->fptr == &jl_f_invoke && nargs >= 2 &&
+             ctx->linfo->specTypes != NULL && is_constant(args[1], ctx)) {
+        // invoke with a constant function and signature: pick the
+        // definition now and call its specialization directly
+        jl_tuple_t *types = static_invoke_types(args[2], ctx);
+        rt1 = (jl_value_t*)types;
+        jl_tuple_t *aty = call_arg_types(&args[3], nargs-2, ctx);
+        rt2 = (jl_value_t*)aty;
+        if (types != NULL && aty != NULL) {
+            jl_value_t *gf =
+                jl_interpret_toplevel_expr_in(ctx->module, args[1],
+                                              &jl_tupleref(ctx->sp,0),
+                                              ctx->sp->length/2);
+            rt3 = gf;
+            jl_function_t *mf = NULL;
+            if (jl_is_func(gf) && jl_is_gf(gf))
+                mf = jl_get_invoke_specialization((jl_function_t*)gf,
+                                                  types, aty);
+            if (mf != NULL) {
+                JL_GC_POP();
+                int last_depth = ctx->argDepth;
+                int argStart = ctx->argDepth;
+                for(size_t i=3; i <= nargs; i++) {
+                    Value *anArg = emit_expr(args[i], ctx, true);
+                    make_gcroot(boxed(anArg), ctx);
+                }
+                Value *myargs;
+                if (ctx->argTemp != NULL) {
+                    myargs = builder.CreateGEP(ctx->argTemp,
+                                               ConstantInt::get(T_int32, argStart));
+                }
+                else {
+                    myargs = Constant::getNullValue(jl_ppvalue_llvmt);
+                }
+                Value *result =
+                    builder.CreateCall3((Value*)mf->linfo->functionObject,
+                                        literal_pointer_val((jl_value_t*)mf),
+                                        myargs,
+                                        ConstantInt::get(T_int32, nargs-2));
+                ctx->argDepth = last_depth;
+                return result;
+            }
+        }
+    }
     // TODO: other known builtins
     JL_GC_POP();
     return NULL;
 }
 
+// calls with more arguments than this always go through jl_apply_generic
+#define MAX_IC_ARGS 8
+
+// call a generic function through an inline cache. the first entry of
+// the site is checked here; on a miss jl_apply_generic_ic checks the
+// rest, dispatches, and refills the site.
+static Value *emit_cached_call(Value *theF, Value *myargs, size_t nargs,
+                               jl_codectx_t *ctx)
+{
+    jl_callsite_t *site = jl_new_callsite(nargs);
+    Value *ent = literal_pointer_val((void*)jl_ic_entry(site,0));
+    Value *hit =
+        builder.CreateICmpEQ(builder.CreateLoad(builder.CreateBitCast(ent, T_psize),
+                                                false),
+                             builder.CreateLoad(jlworld_var, false));
+    for(size_t i=0; i < nargs; i++) {
+        Value *arg = builder.CreateLoad(builder.CreateGEP(myargs,
+                                                          ConstantInt::get(T_int32,i)),
+                                        false);
+        hit = builder.CreateAnd(hit,
+                                builder.CreateICmpEQ(emit_typeof(arg),
+                                                     emit_nthptr(ent, i+2)));
+    }
+    BasicBlock *hitBB = BasicBlock::Create(getGlobalContext(),"ic_hit", ctx->f);
+    BasicBlock *missBB = BasicBlock::Create(getGlobalContext(),"ic_miss");
+    BasicBlock *contBB = BasicBlock::Create(getGlobalContext(),"ic_cont");
+    builder.CreateCondBr(hit, hitBB, missBB);
+
+    builder.SetInsertPoint(hitBB);
+    Value *mfunc = emit_nthptr(ent, 1);
+    Value *fptr = builder.CreateBitCast(emit_nthptr(mfunc, 1), jl_fptr_llvmt);
+    Value *r1 = builder.CreateCall3(fptr, mfunc, myargs,
+                                    ConstantInt::get(T_int32,nargs));
+    builder.CreateBr(contBB);
+
+    ctx->f->getBasicBlockList().push_back(missBB);
+    builder.SetInsertPoint(missBB);
+    Value *icargs[4] = { theF, myargs, ConstantInt::get(T_int32,nargs),
+                         literal_pointer_val((void*)site) };
+    Value *r2 = builder.CreateCall(jlapplygenericic_func,
+                                   ArrayRef<Value*>(&icargs[0], 4));
+    builder.CreateBr(contBB);
+
+    ctx->f->getBasicBlockList().push_back(contBB);
+    builder.SetInsertPoint(contBB);
+    PHINode *result = builder.CreatePHI(jl_pvalue_llvmt, 2);
+    result->addIncoming(r1, hitBB);
+    result->addIncoming(r2, missBB);
+    return result;
+}
+
 static Value *emit_call(jl_value_t **args, size_t arglen, jl_codectx_t *ctx,
                         jl_value_t *expr)
 {
@@ -972,8 +1511,15 @@ static Value *emit_call(jl_value_t **args, size_t arglen, jl_codectx_t *ctx,
     else {
         myargs = Constant::getNullValue(jl_ppvalue_llvmt);
     }
-    Value *result = builder.CreateCall3(theFptr, theF, myargs,
-                                        ConstantInt::get(T_int32,nargs));
+    Value *result;
+    if (theFptr == jlapplygeneric_func && nargs > 0 &&
+        nargs <= MAX_IC_ARGS) {
+        result = emit_cached_call(theF, myargs, nargs, ctx);
+    }
+    else {
+        result = builder.CreateCall3(theFptr, theF, myargs,
+                                     ConstantInt::get(T_int32,nargs));
+    }
 
     ctx->argDepth = last_depth;
     return result;
@@ -1051,6 +1597,52 @@ static Value *emit_checked_var(Value *bp, const char *name, jl_codectx_t *ctx)
     return v;
 }
 
+// read a global that had no binding at compile time. the binding is looked
+// up the first time the code runs and kept in a slot, so later reads cost
+// two loads.
+static Value *emit_lazy_global(jl_sym_t *sym, jl_codectx_t *ctx)
+{
+    jl_binding_t **slot = (jl_binding_t**)calloc(1, sizeof(jl_binding_t*));
+    if (slot == NULL)
+        jl_raise(jl_memory_exception);
+    Value *slotp = literal_pointer_val((void*)slot, jl_ppvalue_llvmt);
+    Value *b0 = builder.CreateLoad(slotp, false);
+    BasicBlock *curBB = builder.GetInsertBlock();
+    BasicBlock *resolveBB = BasicBlock::Create(getGlobalContext(), "resolve",
+                                               ctx->f);
+    BasicBlock *contBB = BasicBlock::Create(getGlobalContext(), "resolved");
+    builder.CreateCondBr(builder.CreateICmpEQ(b0, V_null), resolveBB, contBB);
+    builder.SetInsertPoint(resolveBB);
+    Value *b1 = builder.CreateCall3(jlresolveglobal_func, slotp,
+                                    literal_pointer_val((jl_value_t*)ctx->module),
+                                    literal_pointer_val((jl_value_t*)sym));
+    builder.CreateBr(contBB);
+    ctx->f->getBasicBlockList().push_back(contBB);
+    builder.SetInsertPoint(contBB);
+    PHINode *b = builder.CreatePHI(jl_pvalue_llvmt, 2);
+    b->addIncoming(b0, curBB);
+    b->addIncoming(b1, resolveBB);
+    Value *bp = emit_nthptr_addr(b, offsetof(jl_binding_t,value)/sizeof(void*));
+    return emit_checked_var(bp, sym->name, ctx);
+}
+
+// a global resolved at compile time: constants become literals, anything
+// else is loaded through its binding.
+static Value *emit_global(jl_sym_t *sym, jl_value_t *ty, jl_codectx_t *ctx)
+{
+    jl_binding_t *b = jl_get_binding(ctx->module, sym);
+    if (b == NULL)
+        return emit_lazy_global(sym, ctx);
+    if (b->constp && b->value != NULL)
+        return literal_pointer_val(b->value);
+    Value *bp = literal_pointer_val(&b->value, jl_ppvalue_llvmt);
+    if (ty != (jl_value_t*)jl_any_type &&
+        !jl_subtype((jl_value_t*)jl_undef_type, ty, 0)) {
+        return builder.CreateLoad(bp, false);
+    }
+    return emit_checked_var(bp, sym->name, ctx);
+}
+
 static Value *emit_var(jl_sym_t *sym, jl_value_t *ty, jl_codectx_t *ctx)
 {
     // variable
@@ -1064,6 +1656,15 @@ static Value *emit_var(jl_sym_t *sym, jl_value_t *ty, jl_codectx_t *ctx)
                 return literal_pointer_val(jl_tupleref(ctx->sp, i+1));
             }
         }
+        return emit_global(sym, ty, ctx);
+    }
+    int ntup = stack_tuple_len((jl_value_t*)sym, ctx);
+    if (ntup > 0) {
+        // used in some way the escape analysis allows but that needs a
+        // real tuple
+        Value *slots = emit_stack_tuple_slots((jl_value_t*)sym, ctx);
+        return builder.CreateCall3(jltuple_func, V_null, slots,
+                                   ConstantInt::get(T_int32, ntup));
     }
     Value *bp = var_binding_pointer(sym, NULL, false, ctx);
     Value *arg = (*ctx->arguments)[sym->name];
@@ -1085,6 +1686,25 @@ static void emit_assignment(jl_value_t *l, jl_value_t *r, jl_codectx_t *ctx)
         s = jl_symbolnode_sym(l);
     else
         assert(false);
+    int ntup = stack_tuple_len((jl_value_t*)s, ctx);
+    if (ntup > 0) {
+        // evaluate all elements before storing any, since they may refer
+        // to the old value
+        jl_array_t *targs = ((jl_expr_t*)r)->args;
+        int last_depth = ctx->argDepth;
+        int i;
+        for(i=0; i < ntup; i++)
+            make_gcroot(boxed(emit_expr(jl_cellref(targs,i+1), ctx, true)),
+                        ctx);
+        Value *slots = (*ctx->vars)[s->name];
+        for(i=0; i < ntup; i++) {
+            Value *elt = builder.CreateConstGEP1_32(ctx->argTemp, last_depth+i);
+            builder.CreateStore(builder.CreateLoad(elt, false),
+                                builder.CreateConstGEP1_32(slots, i));
+        }
+        ctx->argDepth = last_depth;
+        return;
+    }
     jl_binding_t *bnd=NULL;
     Value *bp = var_binding_pointer(s, &bnd, true, ctx);
     if (bnd) {
@@ -1098,8 +1718,15 @@ static void emit_assignment(jl_value_t *l, jl_value_t *r, jl_codectx_t *ctx)
             builder.CreateStore(emit_unbox(vt->getContainedType(0), vt,
                                            emit_unboxed(r, ctx)),
                                 bp);
-        else
+        else {
             builder.CreateStore(boxed(emit_expr(r, ctx, true)), bp);
+            if (isBoxed(s->name, ctx)) {
+                // bp points into a Box
+                Value *box = builder.CreateGEP(bp, ConstantInt::get(T_int32, -1));
+                emit_write_barrier(builder.CreateBitCast(box, jl_pvalue_llvmt),
+                                   ctx);
+            }
+        }
     }
 }
 
@@ -1151,16 +1778,7 @@ static Value *emit_expr(jl_value_t *expr, jl_codectx_t *ctx, bool value)
     else if (jl_is_topnode(expr)) {
         jl_sym_t *var = (jl_sym_t*)jl_fieldref(expr,0);
         jl_value_t *etype = expr_type(expr, ctx);
-        jl_binding_t *b = jl_get_binding(ctx->module, var);
-        if (b == NULL)
-            b = jl_get_binding_wr(ctx->module, var);
-        Value *bp = literal_pointer_val(&b->value, jl_ppvalue_llvmt);
-        if ((b->constp && b->value!=NULL) ||
-            (etype!=(jl_value_t*)jl_any_type &&
-             !jl_subtype((jl_value_t*)jl_undef_type, etype, 0))) {
-            return builder.CreateLoad(bp, false);
-        }
-        return emit_checked_var(bp, var->name, ctx);
+        return emit_global(var, etype, ctx);
     }
     if (!jl_is_expr(expr)) {
         // numeric literals
@@ -1311,6 +1929,17 @@ static Value *emit_expr(jl_value_t *expr, jl_codectx_t *ctx, bool value)
     else if (ex->head == exc_sym) {
         return builder.CreateLoad(jlexc_var, true);
     }
+    else if (ex->head == boundscheck_sym) {
+        // (boundscheck false) starts a region without array bounds
+        // checks, and (boundscheck) ends it. any other argument is ignored.
+        if (ex->args->length > 0) {
+            if (jl_exprarg(ex,0) == jl_false)
+                ctx->inbounds++;
+        }
+        else if (ctx->inbounds > 0) {
+            ctx->inbounds--;
+        }
+    }
     else if (ex->head == leave_sym) {
         assert(jl_is_long(args[0]));
         builder.CreateCall(jlleave_func,
@@ -1402,10 +2031,12 @@ static void emit_function(jl_lambda_info_t *lam, Function *f)
     std::map<std::string, bool> isAssigned;
     std::map<std::string, bool> isCaptured;
     std::map<std::string, bool> escapes;
+    std::map<std::string, int> stackTuples;
     std::map<std::string, jl_value_t*> declTypes;
     std::map<int, BasicBlock*> labels;
     std::map<int, Value*> savestates;
     std::map<int, Value*> jmpbufs;
+    std::set<jl_value_t*> uncheckedRefs;
     jl_array_t *largs = jl_lam_args(ast);
     jl_array_t *lvars = jl_lam_locals(ast);
     Function::arg_iterator AI = f->arg_begin();
@@ -1420,10 +2051,13 @@ static void emit_function(jl_lambda_info_t *lam, Function *f)
     ctx.isAssigned = &isAssigned;
     ctx.isCaptured = &isCaptured;
     ctx.escapes = &escapes;
+    ctx.stackTuples = &stackTuples;
     ctx.declTypes = &declTypes;
     ctx.labels = &labels;
     ctx.savestates = &savestates;
     ctx.jmpbufs = &jmpbufs;
+    ctx.uncheckedRefs = &uncheckedRefs;
+    ctx.inbounds = 0;
     ctx.module = lam->module;
     ctx.ast = ast;
     ctx.sp = sparams;
@@ -1540,9 +2174,33 @@ static void emit_function(jl_lambda_info_t *lam, Function *f)
         ctx.envArg = emit_nthptr((Value*)&fArg, 2);
     }
 
+    // find locals that can be stack tuples. ctx.stackTuples stays empty
+    // until their gc frame slots are laid out below.
+    std::map<std::string, int> tupleCands;
+    for(i=0; i < lvars->length; i++) {
+        char *argname = ((jl_sym_t*)jl_cellref(lvars,i))->name;
+        if (!store_unboxed_p(argname, &ctx) && !isCaptured[argname])
+            tupleCands[argname] = -1;
+    }
+    ctx.stackTuples = &tupleCands;
+    find_stack_tuples((jl_value_t*)ast, &ctx);
+    ctx.stackTuples = &stackTuples;
+
+    find_unchecked_refs(jl_lam_body(ast)->args, &ctx);
+
     int32_t argdepth=0, vsp=0;
     max_arg_depth((jl_value_t*)ast, &argdepth, &vsp, true, &ctx);
     n_roots += argdepth;
+    for(std::map<std::string,int>::iterator it = tupleCands.begin();
+        it != tupleCands.end(); it++) {
+        if ((*it).second > 0 && !escapes[(*it).first]) {
+            // one root was already counted for the variable
+            n_roots += (*it).second-1;
+        }
+        else {
+            (*it).second = 0;
+        }
+    }
     //total_roots += n_roots;
     ctx.argDepth = 0;
     //ctx.maxDepth = 0;
@@ -1597,11 +2255,13 @@ static void emit_function(jl_lambda_info_t *lam, Function *f)
         }
         else {
             Value *lv = builder.CreateConstGEP1_32(ctx.argTemp,varnum);
-            varnum++;
+            int ntup = tupleCands[argname];
+            varnum += (ntup > 0 ? ntup : 1);
             localVars[argname] = lv;
         }
     }
     assert(varnum == n_roots);
+    stackTuples = tupleCands;
 
     // create boxes for boxed locals
     for(i=0; i < lvars->length; i++) {
@@ -1809,6 +2469,94 @@ extern "C" jl_value_t *jl_new_box(jl_value_t *v)
     return box;
 }
 
+static FunctionPassManager *make_fpm(int level)
+{
+    FunctionPassManager *FPM = new FunctionPassManager(jl_Module);
+    FPM->add(new TargetData(*jl_ExecutionEngine->getTargetData()));
+
+    // list of passes from vmkit
+    FPM->add(createCFGSimplificationPass()); // Clean up disgusting code
+    FPM->add(createPromoteMemoryToRegisterPass());// Kill useless allocas
+    if (level == 0) {
+        FPM->doInitialization();
+        return FPM;
+    }
+    
+    FPM->add(createInstructionCombiningPass()); // Cleanup for scalarrepl.
+    FPM->add(createScalarReplAggregatesPass()); // Break up aggregate allocas
+    FPM->add(createInstructionCombiningPass()); // Cleanup for scalarrepl.
+    if (level == 1) {
+        FPM->add(createEarlyCSEPass());
+        FPM->add(createAggressiveDCEPass());
+        FPM->add(createCFGSimplificationPass());
+        FPM->doInitialization();
+        return FPM;
+    }
+
+    FPM->add(createJumpThreadingPass());        // Thread jumps.
+    FPM->add(createCFGSimplificationPass());    // Merge & remove BBs
+    //FPM->add(createInstructionCombiningPass()); // Combine silly seq's
+    
+    //FPM->add(createCFGSimplificationPass());    // Merge & remove BBs
+    FPM->add(createReassociatePass());          // Reassociate expressions
+    if (level >= 3) {
+        FPM->add(createEarlyCSEPass());
+        FPM->add(createLoopIdiomPass());
+    }
+    FPM->add(createLoopRotatePass());           // Rotate loops.
+    FPM->add(createLICMPass());                 // Hoist loop invariants
+    FPM->add(createLoopUnswitchPass());         // Unswitch loops.
+    FPM->add(createInstructionCombiningPass()); 
+    FPM->add(createIndVarSimplifyPass());       // Canonicalize indvars
+    if (level >= 3)
+        FPM->add(createLoopDeletionPass());     // Delete dead loops
+    FPM->add(createLoopUnrollPass());           // Unroll small loops
+    //FPM->add(createLoopStrengthReducePass());   // (jwb added)
+    
+    FPM->add(createInstructionCombiningPass()); // Clean up after the unroller
+    if (level >= 3) {
+        // unrolling exposes more invariants and redundancies
+        FPM->add(createLICMPass());
+        FPM->add(createGVNPass());
+        FPM->add(createInstructionCombiningPass());
+    }
+    FPM->add(createGVNPass());                  // Remove redundancies
+    if (level >= 3)
+        FPM->add(createMemCpyOptPass());        // Remove memcpy / form memset
+    FPM->add(createSCCPPass());                 // Constant prop with SCCP
+    
+    // Run instcombine after redundancy elimination to exploit opportunities
+    // opened up by them.
+    if (level >= 3)
+        FPM->add(createSinkingPass());
+    //FPM->add(createInstructionSimplifierPass());///////// ****
+    FPM->add(createInstructionCombiningPass());
+    FPM->add(createJumpThreadingPass());         // Thread jumps
+    FPM->add(createDeadStoreEliminationPass());  // Delete dead stores
+    FPM->add(createAggressiveDCEPass());         // Delete dead instructions
+    FPM->add(createCFGSimplificationPass());     // Merge & remove BBs
+
+    FPM->doInitialization();
+    return FPM;
+}
+
+extern "C" DLLEXPORT void jl_set_opt_level(int level)
+{
+    if (level < 0) level = 0;
+    if (level > JL_MAX_OPT_LEVEL) level = JL_MAX_OPT_LEVEL;
+    jl_opt_level = level;
+}
+
+extern "C" DLLEXPORT int jl_get_opt_level(void)
+{
+    return jl_opt_level;
+}
+
+extern "C" DLLEXPORT int jl_get_max_opt_level(void)
+{
+    return JL_MAX_OPT_LEVEL;
+}
+
 static void init_julia_llvm_env(Module *m)
 {
     T_int1  = Type::getInt1Ty(getGlobalContext());
@@ -1959,10 +2707,39 @@ static void init_julia_llvm_env(Module *m)
     jl_ExecutionEngine->addGlobalMapping(jldeclareconst_func,
                                          (void*)&jl_declare_constant);
 
+    std::vector<Type *> resargs(0);
+    resargs.push_back(jl_ppvalue_llvmt);
+    resargs.push_back(jl_pvalue_llvmt);
+    resargs.push_back(jl_pvalue_llvmt);
+    jlresolveglobal_func =
+        Function::Create(FunctionType::get(jl_pvalue_llvmt, resargs, false),
+                         Function::ExternalLinkage,
+                         "jl_resolve_global_slot", jl_Module);
+    jl_ExecutionEngine->addGlobalMapping(jlresolveglobal_func,
+                                         (void*)&jl_resolve_global_slot);
+
     jltuple_func = jlfunc_to_llvm("jl_f_tuple", (void*)*jl_f_tuple);
     jlapplygeneric_func =
         jlfunc_to_llvm("jl_apply_generic", (void*)*jl_apply_generic);
 
+    std::vector<Type*> icargs(0);
+    icargs.push_back(jl_pvalue_llvmt);
+    icargs.push_back(jl_ppvalue_llvmt);
+    icargs.push_back(T_int32);
+    icargs.push_back(T_pint8);
+    jlapplygenericic_func =
+        Function::Create(FunctionType::get(jl_pvalue_llvmt, icargs, false),
+                         Function::ExternalLinkage,
+                         "jl_apply_generic_ic", jl_Module);
+    jl_ExecutionEngine->addGlobalMapping(jlapplygenericic_func,
+                                         (void*)&jl_apply_generic_ic);
+    jlworld_var =
+        new GlobalVariable(*jl_Module, T_size,
+                           false, GlobalVariable::ExternalLinkage,
+                           NULL, "jl_world_counter");
+    jl_ExecutionEngine->addGlobalMapping(jlworld_var,
+                                         (void*)&jl_world_counter);
+
     std::vector<Type*> args3(0);
     args3.push_back(jl_pvalue_llvmt);
     jlbox_func =
@@ -2028,50 +2805,30 @@ static void init_julia_llvm_env(Module *m)
                          "allocobj", jl_Module);
     jl_ExecutionEngine->addGlobalMapping(jlallocobj_func, (void*)&allocobj);
 
-    // set up optimization passes
-    FPM = new FunctionPassManager(jl_Module);
-    FPM->add(new TargetData(*jl_ExecutionEngine->getTargetData()));
-    
-    // list of passes from vmkit
-    FPM->add(createCFGSimplificationPass()); // Clean up disgusting code
-    FPM->add(createPromoteMemoryToRegisterPass());// Kill useless allocas
-    
-    FPM->add(createInstructionCombiningPass()); // Cleanup for scalarrepl.
-    FPM->add(createScalarReplAggregatesPass()); // Break up aggregate allocas
-    FPM->add(createInstructionCombiningPass()); // Cleanup for scalarrepl.
-    FPM->add(createJumpThreadingPass());        // Thread jumps.
-    FPM->add(createCFGSimplificationPass());    // Merge & remove BBs
-    //FPM->add(createInstructionCombiningPass()); // Combine silly seq's
-    
-    //FPM->add(createCFGSimplificationPass());    // Merge & remove BBs
-    FPM->add(createReassociatePass());          // Reassociate expressions
-    //FPM->add(createEarlyCSEPass()); //// ****
-    //FPM->add(createLoopIdiomPass()); //// ****
-    FPM->add(createLoopRotatePass());           // Rotate loops.
-    FPM->add(createLICMPass());                 // Hoist loop invariants
-    FPM->add(createLoopUnswitchPass());         // Unswitch loops.
-    FPM->add(createInstructionCombiningPass()); 
-    FPM->add(createIndVarSimplifyPass());       // Canonicalize indvars
-    //FPM->add(createLoopDeletionPass());         // Delete dead loops
-    FPM->add(createLoopUnrollPass());           // Unroll small loops
-    //FPM->add(createLoopStrengthReducePass());   // (jwb added)
-    
-    FPM->add(createInstructionCombiningPass()); // Clean up after the unroller
-    FPM->add(createGVNPass());                  // Remove redundancies
-    //FPM->add(createMemCpyOptPass());            // Remove memcpy / form memset  
-    FPM->add(createSCCPPass());                 // Constant prop with SCCP
-    
-    // Run instcombine after redundancy elimination to exploit opportunities
-    // opened up by them.
-    //FPM->add(createSinkingPass()); ////////////// ****
-    //FPM->add(createInstructionSimplifierPass());///////// ****
-    FPM->add(createInstructionCombiningPass());
-    FPM->add(createJumpThreadingPass());         // Thread jumps
-    FPM->add(createDeadStoreEliminationPass());  // Delete dead stores
-    FPM->add(createAggressiveDCEPass());         // Delete dead instructions
-    FPM->add(createCFGSimplificationPass());     // Merge & remove BBs
+#ifdef JL_GC_MARKSWEEP
+    jlgcgen_var =
+        new GlobalVariable(*jl_Module, T_int32,
+                           false, GlobalVariable::ExternalLinkage,
+                           NULL, "jl_gc_generational");
+    jl_ExecutionEngine->addGlobalMapping(jlgcgen_var,
+                                         (void*)&jl_gc_generational);
+    std::vector<Type *> wbargs(0);
+    wbargs.push_back(jl_pvalue_llvmt);
+    jlgcwb_func =
+        Function::Create(FunctionType::get(T_void, wbargs, false),
+                         Function::ExternalLinkage,
+                         "jl_gc_wb_slow", jl_Module);
+    jl_ExecutionEngine->addGlobalMapping(jlgcwb_func, (void*)&jl_gc_wb_slow);
+    jlgcwbarray_func =
+        Function::Create(FunctionType::get(T_void, wbargs, false),
+                         Function::ExternalLinkage,
+                         "jl_gc_wb_array_slow", jl_Module);
+    jl_ExecutionEngine->addGlobalMapping(jlgcwbarray_func,
+                                         (void*)&jl_gc_wb_array_slow);
+#endif
 
-    FPM->doInitialization();
+    for(int level=0; level <= JL_MAX_OPT_LEVEL; level++)
+        FPMs[level] = make_fpm(level);
 }
 
 extern "C" void jl_init_codegen(void)
@@ -294,6 +294,11 @@ static void jl_serialize_value_(ios_t *s, jl_value_t *v)
         jl_function_t *f = (jl_function_t*)v;
         jl_serialize_value(s, (jl_value_t*)f->linfo);
         jl_serialize_value(s, f->env);
+        // compiled functions are saved as trampolines and regenerated on
+        // first call. the inferred AST and method caches are kept, so only
+        // code generation is repeated. the JIT's machine code cannot be
+        // saved: it refers to heap objects, call sites and binding slots by
+        // absolute address, and the JIT does not emit relocatable objects.
         if (f->linfo && f->linfo->ast &&
             (jl_is_expr(f->linfo->ast) || jl_is_tuple(f->linfo->ast)) &&
             f->fptr != &jl_trampoline) {
@@ -321,6 +326,7 @@ static void jl_serialize_value_(ios_t *s, jl_value_t *v)
         jl_serialize_value(s, (jl_value_t*)li->file);
         jl_serialize_value(s, (jl_value_t*)li->line);
         jl_serialize_value(s, (jl_value_t*)li->module);
+        write_int8(s, li->optlevel);
     }
     else if (jl_typeis(v, jl_module_type)) {
         jl_serialize_module(s, (jl_module_t*)v);
@@ -516,10 +522,9 @@ static jl_value_t *jl_deserialize_value(ios_t *s)
             len = read_uint8(s);
         else
             len = read_int32(s);
-        char *name = alloca(len+1);
+        char *name = alloca(len);
         ios_read(s, name, len);
-        name[len] = '\0';
-        jl_value_t *s = (jl_value_t*)jl_symbol(name);
+        jl_value_t *s = (jl_value_t*)jl_symbol_n(name, len);
         if (usetable)
             ptrhash_put(&backref_table, (void*)(ptrint_t)pos, s);
         return s;
@@ -606,6 +611,9 @@ static jl_value_t *jl_deserialize_value(ios_t *s)
         li->functionObject = NULL;
         li->inInference = 0;
         li->inCompile = 0;
+        li->interp = 0;
+        li->nticks = 0;
+        li->optlevel = (int8_t)read_int8(s);
         li->unspecialized = NULL;
         return (jl_value_t*)li;
     }
@@ -746,6 +754,8 @@ void jl_save_system_image(char *fname, char *startscriptname)
         jl_methtable_t *mt = jl_gf_mtable((jl_function_t*)jl_ascii_string_type);
         mt->cache = NULL;
         mt->cache_arg1 = NULL;
+        mt->cache_hash = NULL;
+        mt->invoke_cache = NULL;
         mt->defs->func->linfo->tfunc = (jl_value_t*)jl_null;
         mt->defs->func->linfo->specializations = NULL;
     }
@@ -828,6 +838,7 @@ void jl_restore_system_image(char *fname)
 
     jl_get_builtin_hooks();
     jl_get_system_hooks();
+    jl_type_memo_clear();
     jl_boot_file_loaded = 1;
     jl_typeinf_func = (jl_function_t*)jl_get_global(jl_system_module,
                                                     jl_symbol("typeinf_ext"));
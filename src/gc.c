@@ -1,11 +1,19 @@
 /*
   allocation and garbage collection
   . non-moving, precise mark and sweep collector
-  . pool-allocates small objects, keeps big objects on a simple list
+  . pool-allocates small objects, and big ones up to 1MB in size-binned
+    arenas. huge objects are mapped one by one.
+  . optionally generational: objects that survive a collection become old,
+    and minor collections only trace and free young objects. old objects
+    that get a reference stored into them are kept in a remembered set by
+    the write barrier (jl_gc_wb).
 */
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/mman.h>
 #include "julia.h"
 
 // with MEMDEBUG, every object is allocated explicitly with malloc, and
@@ -23,16 +31,35 @@
 // OBJPROFILE counts objects by type
 //#define OBJPROFILE
 
-#define GC_PAGE_SZ (1536*sizeof(void*)+8)//bytes
+// pages are aligned to their size, so the page holding a pool object can be
+// found from its address.
+#define GC_PAGE_LG2 14
+#define GC_PAGE_SZ (1<<GC_PAGE_LG2)//bytes
+
+// one bit per 8-byte granule in each page bitmap. no two pool objects
+// start in the same granule, since the smallest size class is 8 bytes.
+#define GC_PAGE_NGRAN (GC_PAGE_SZ/8)
+#define GC_PAGE_HDR (32 + 2*(GC_PAGE_NGRAN/8))
+
+struct _pool_t;
 
 typedef struct _gcpage_t {
     union {
-        struct _gcpage_t *next;
-        char _pad[8];
+        struct {
+            struct _gcpage_t *next;
+            struct _pool_t *pool;
+            int unswept;   // marks are from the last collection
+            uint32_t marks[GC_PAGE_NGRAN/32];
+            uint32_t age[GC_PAGE_NGRAN/32];
+        };
+        char _pad[GC_PAGE_HDR];
     };
-    char data[GC_PAGE_SZ - 8];
+    char data[GC_PAGE_SZ - GC_PAGE_HDR];
 } gcpage_t;
 
+#define gc_page_of(v) ((gcpage_t*)((uptrint_t)(v) & ~(uptrint_t)(GC_PAGE_SZ-1)))
+#define gc_gran(pg,v) ((size_t)(((char*)(v) - (char*)(pg))>>3))
+
 typedef struct _gcval_t {
     union {
         struct _gcval_t *next;
@@ -45,6 +72,7 @@ typedef struct _gcval_t {
 typedef struct _pool_t {
     size_t osize;
     gcpage_t *pages;
+    gcpage_t *unswept;  // pages left to sweep since the last collection
     gcval_t *freelist;
 } pool_t;
 
@@ -61,11 +89,25 @@ typedef struct _bigval_t {
         struct {
             uptrint_t marked:1;
             uptrint_t isobj:1;
+            uptrint_t old:1;
+            uptrint_t huge:1;   // mmapped by itself
+            // size for heap accounting, saturated on 32-bit
+            uptrint_t nbytes:(sizeof(uptrint_t)*8-4);
         };
     };
     char _data[1];
 } bigval_t;
 
+#define BV_MAXBYTES (((uptrint_t)-1)>>4)
+
+// big objects of at least this size get their own mapping, so they start
+// out zeroed and their memory goes back to the OS when they are freed
+#define GC_HUGE_SZ (1024*1024)
+
+extern size_t jl_page_size;
+#define huge_mapsize(nb) (((nb)+BVOFFS*sizeof(void*)+jl_page_size-1) & \
+                          ~(jl_page_size-1))
+
 #if defined(MEMDEBUG) || defined(MEMPROFILE)
 # ifdef __LP64__
 #  define BVOFFS 3
@@ -76,21 +118,195 @@ typedef struct _bigval_t {
 #define BVOFFS 2
 #endif
 
+// big objects below GC_HUGE_SZ live in blocks carved out of mmapped
+// arenas, one list of arenas per size bin. bins are spaced four per power
+// of two from 2KB, and the last one also fits the header of an object just
+// under GC_HUGE_SZ. a block whose nbytes is 0 is free.
+#define N_BIG_BINS 36
+#define GC_BIG_ARENA_SZ (1024*1024)
+#define GC_BIG_ARENA_HDR 64
+// free blocks at least this big give their whole pages back to the OS
+#define GC_BIG_MADV_SZ (64*1024)
+
+typedef struct _bigarena_t {
+    struct _bigarena_t *next;
+    size_t nblocks;
+    size_t mapsize;
+} bigarena_t;
+
+typedef struct _bigbin_t {
+    size_t bsize;
+    bigarena_t *arenas;
+    bigval_t *freelist;
+} bigbin_t;
+
+#define arena_block(b,a,i) \
+    ((bigval_t*)((char*)(a) + GC_BIG_ARENA_HDR + (i)*(b)->bsize))
+
 #define gc_val(o)     ((gcval_t*)(((void**)(o))-1))
-#define gc_marked(o)  (gc_val(o)->marked)
-#define gc_setmark(o) (gc_val(o)->marked=1)
-#define gc_marked_obj(o)  (((gcval_t*)(o))->marked)
-#define gc_setmark_obj(o) (((gcval_t*)(o))->marked=1)
+#define bigval_of(v) ((bigval_t*)(((void**)(v))-BVOFFS))
+#define gc_typeof(v) ((jl_value_t*)(((uptrint_t)jl_typeof(v))&~1UL))
+
+// map from address to "is a pool page", one bit per page in 4GB regions
+#ifdef __LP64__
+#define REGION_IDX(a) ((a)>>32)
+#define N_REGIONS     (1<<16)
+#else
+#define REGION_IDX(a) (0)
+#define N_REGIONS     1
+#endif
+#define REGION_PAGE(a) ((size_t)(((a)&0xffffffffUL)>>GC_PAGE_LG2))
+#define REGION_NPAGES  ((size_t)1<<(32-GC_PAGE_LG2))
+
+static uint32_t *pagemap[N_REGIONS];
+
+static void pagemap_set(gcpage_t *pg, int on)
+{
+    uptrint_t a = (uptrint_t)pg;
+    uptrint_t r = REGION_IDX(a);
+    if (pagemap[r] == NULL) {
+        if (!on) return;
+        pagemap[r] = (uint32_t*)calloc(REGION_NPAGES/32, sizeof(uint32_t));
+        if (pagemap[r] == NULL)
+            jl_raise(jl_memory_exception);
+    }
+    size_t i = REGION_PAGE(a);
+    if (on)
+        pagemap[r][i>>5] |= (1U<<(i&31));
+    else
+        pagemap[r][i>>5] &= ~(1U<<(i&31));
+}
+
+static int in_pool_page(void *v)
+{
+    uptrint_t a = (uptrint_t)v;
+    uptrint_t r = REGION_IDX(a);
+    if (r >= N_REGIONS || pagemap[r] == NULL)
+        return 0;
+    size_t i = REGION_PAGE(a);
+    return (pagemap[r][i>>5]>>(i&31))&1;
+}
 
-static bigval_t *big_objects = NULL;
+static inline int page_age(gcpage_t *pg, void *v)
+{
+    size_t i = gc_gran(pg, v);
+    return (pg->age[i>>5]>>(i&31))&1;
+}
+
+static inline void page_setage(gcpage_t *pg, void *v, int old)
+{
+    size_t i = gc_gran(pg, v);
+    if (old)
+        pg->age[i>>5] |= (1U<<(i&31));
+    else
+        pg->age[i>>5] &= ~(1U<<(i&31));
+}
+
+static inline int page_marked(gcpage_t *pg, void *v)
+{
+    size_t i = gc_gran(pg, v);
+    return (pg->marks[i>>5]>>(i&31))&1;
+}
+
+// pool objects and buffers are marked in their page's mark bitmap, so
+// objects on pages that have not been swept yet have clean type words.
+// big objects and symbols are marked in their first word, and big buffers
+// in their header.
+static inline int gc_marked_obj(jl_value_t *v)
+{
+    if (in_pool_page(v))
+        return page_marked(gc_page_of(v), v);
+    return ((gcval_t*)v)->marked;
+}
+
+static inline int gc_marked_buf(void *b)
+{
+    gcval_t *slot = gc_val(b);
+    if (in_pool_page(slot))
+        return page_marked(gc_page_of(slot), slot);
+    return slot->marked;
+}
 
 #define N_POOLS 42
-static pool_t norm_pools[N_POOLS];
-static pool_t ephe_pools[N_POOLS];
-static pool_t *pools = &norm_pools[0];
+static size_t pool_osize[N_POOLS];
+
+// allocation context. every thread that allocates has its own pools, big
+// object list and allocation counter, so the allocation fast path needs
+// no locking. the main thread's context is set up by jl_gc_init; other
+// threads call jl_gc_register_thread.
+typedef struct _gc_ctx_t {
+    pool_t norm_pools[N_POOLS];
+    pool_t ephe_pools[N_POOLS];
+    pool_t *pools;
+    bigbin_t big_bins[N_BIG_BINS];
+    bigval_t *big_objects;  // huge objects and acquired buffers
+    size_t allocd_bytes;
+    int owned;            // a thread is using this context
+    volatile int safe;    // the owner is stopped or not touching the heap
+    struct _gc_ctx_t *next;
+} gc_ctx_t;
+
+static gc_ctx_t main_ctx;
+static gc_ctx_t *gc_ctxs = &main_ctx;
+// set by jl_gc_init for the main thread and by jl_gc_register_thread
+static __thread gc_ctx_t *gc_ctx = NULL;
+static int n_gc_threads = 1;
+
+// the calling thread's context. a thread that never registered has none;
+// letting it use the main thread's pools would race with that thread, and
+// raising an error would itself allocate.
+static gc_ctx_t *gc_thread_ctx(void)
+{
+    gc_ctx_t *ctx = gc_ctx;
+    if (__unlikely(ctx == NULL)) {
+        ios_printf(ios_stderr, "fatal: heap access from a thread that did "
+                   "not call jl_gc_register_thread\n");
+        abort();
+    }
+    return ctx;
+}
 
-static size_t allocd_bytes = 0;
-static const size_t collect_interval = 3200*1024*sizeof(void*);
+// stopping the world. a thread that wants to collect sets gc_stop_world
+// and waits until every other context is safe. threads notice the request
+// at safepoints, which are in the allocation slow paths and
+// jl_gc_safepoint.
+static pthread_mutex_t gc_ctx_mut = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gc_safe_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t gc_resume_cond = PTHREAD_COND_INITIALIZER;
+static volatile int gc_stop_world = 0;
+
+static size_t collect_interval = 3200*1024*sizeof(void*);
+
+// heap sizing policy: the next collection happens after allocating
+// gc_heap_mult times the bytes that survived the last one, clamped to
+// [gc_interval_min, gc_interval_max].
+static double gc_heap_mult = 1.0;
+static size_t gc_interval_min = 3200*1024*sizeof(void*);
+static size_t gc_interval_max = (size_t)256*1024*1024*sizeof(void*);
+static size_t live_bytes = 0;      // measured by the last collection
+
+// pool pages and big objects currently allocated, and a size the heap
+// should not grow past without a full collection first (0 for none)
+static size_t heap_size = 0;
+static size_t gc_heap_limit = 0;
+
+// generational mode
+DLLEXPORT int jl_gc_generational = 0;
+static int gc_minor = 0;           // collection in progress is minor
+static int gc_full_pending = 1;    // ages are not valid until a full sweep
+static int n_minor = 0;
+static const int minor_per_full = 8;
+// old objects a reference was stored into since the last collection
+static arraylist_t remset;
+// old objects the runtime mutates without barriers (types, method tables,
+// modules, tasks, ...). these are rescanned by every minor collection.
+static arraylist_t rescan_objs;
+
+static int gc_isold(jl_value_t *v);
+static int sweep_minor = 0;        // the pending lazy sweep is for a minor
+                                   // collection
+static int sweep_page(pool_t *p, gcpage_t *pg, int keep);
+static int sweep_next_page(pool_t *p);
 
 static htable_t finalizer_table;
 static arraylist_t to_finalize;
@@ -103,6 +319,42 @@ static arraylist_t weak_refs;
 static htable_t obj_counts;
 #endif
 
+// statistics kept for jl_gc_get_stats. times are in seconds.
+#define GC_NPAUSES 64
+static struct {
+    size_t ncollect;
+    size_t nminor;
+    size_t nfinalized;
+    size_t allocd_total;     // up to the last collection
+    size_t big_live;
+    size_t pool_live[N_POOLS];
+    double pause_total;
+    double pause_max;
+    double mark_total;
+    double sweep_total;
+    double pauses[GC_NPAUSES];  // ring buffer, indexed by ncollect
+} gc_st;
+
+// allocation profiler. when alloc_sample_period is nonzero, every
+// alloc_sample_period'th allocation records its type, size and the return
+// addresses on the stack.
+#define ALLOC_BT_MAX 24
+typedef struct _alloc_sample_t {
+    jl_value_t *type;    // NULL for buffers and unknown types
+    size_t sz;
+    size_t nframes;
+    size_t frames[ALLOC_BT_MAX];
+} alloc_sample_t;
+
+static size_t alloc_sample_period = 0;
+static size_t alloc_sample_left = 0;
+static alloc_sample_t *alloc_samples = NULL;
+static size_t n_alloc_samples = 0;
+static size_t max_alloc_samples = 0;
+// the last sampled object. callers of allocobj store the type after it
+// returns, so it is only read later.
+static jl_value_t *alloc_sample_pending = NULL;
+
 int jl_gc_n_preserved_values(void)
 {
     return preserved_values.len;
@@ -138,9 +390,10 @@ static void sweep_weak_refs(void)
         return;
     do {
         wr = (jl_weakref_t*)lst[n];
-        if (gc_marked_obj(wr)) {
+        if (gc_marked_obj((jl_value_t*)wr) || (gc_minor && gc_isold((jl_value_t*)wr))) {
             // weakref itself is alive
-            if (!gc_marked_obj(wr->value))
+            if (!gc_marked_obj(wr->value) &&
+                !(gc_minor && gc_isold(wr->value)))
                 wr->value = (jl_value_t*)jl_nothing;
             n++;
         }
@@ -180,6 +433,7 @@ static void run_finalizers(void)
         }
         f = (jl_function_t*)ff;
         assert(jl_is_function(f));
+        gc_st.nfinalized++;
         jl_apply(f, (jl_value_t**)&o, 1);
     }
     JL_GC_POP();
@@ -217,26 +471,122 @@ static int szclass(size_t sz)
     return 41;
 }
 
-static void *alloc_big(size_t sz, int isobj)
+static void gc_collect(int full);
+
+// growing the heap by sz bytes would pass the soft limit. it is only
+// enforced once enough was allocated since the last collection, so a heap
+// whose live data is over the limit does not collect on every allocation.
+static int gc_over_limit(gc_ctx_t *ctx, size_t sz)
+{
+    return (gc_heap_limit != 0 && heap_size + sz > gc_heap_limit &&
+            ctx->allocd_bytes >= gc_heap_limit/16);
+}
+
+void jl_gc_safepoint(void);
+
+static size_t big_bin_size(int i)
 {
-    if (allocd_bytes > collect_interval) {
-        jl_gc_collect();
+    if (i == N_BIG_BINS-1)
+        return GC_HUGE_SZ + GC_BIG_ARENA_HDR;
+    int k = 11 + i/4;
+    return ((size_t)1<<k) + (i%4+1)*((size_t)1<<(k-2));
+}
+
+// bin for a block of nb bytes, header included
+static int big_binclass(size_t nb)
+{
+    if (nb <= big_bin_size(0))
+        return 0;
+    int k = 11;
+    while (((size_t)1<<(k+1)) < nb)
+        k++;
+    size_t step = (size_t)1<<(k-2);
+    int i = (k-11)*4 + (int)((nb - ((size_t)1<<k) + step-1)/step) - 1;
+    return (i < N_BIG_BINS ? i : N_BIG_BINS-1);
+}
+
+// map an arena holding as many blocks as fit in GC_BIG_ARENA_SZ, at
+// least one, and put them on the bin's free list in address order
+static void add_big_arena(bigbin_t *b)
+{
+    size_t nblocks = (GC_BIG_ARENA_SZ - GC_BIG_ARENA_HDR)/b->bsize;
+    if (nblocks == 0)
+        nblocks = 1;
+    size_t mapsize = (GC_BIG_ARENA_HDR + nblocks*b->bsize + jl_page_size-1) &
+        ~(jl_page_size-1);
+    bigarena_t *a = (bigarena_t*)mmap(NULL, mapsize, PROT_READ|PROT_WRITE,
+                                      MAP_PRIVATE|MAP_ANON, -1, 0);
+    if (a == MAP_FAILED)
+        jl_raise(jl_memory_exception);
+    a->nblocks = nblocks;
+    a->mapsize = mapsize;
+    size_t i;
+    for(i=nblocks; i > 0; i--) {
+        bigval_t *v = arena_block(b, a, i-1);
+        v->next = b->freelist;
+        b->freelist = v;
+    }
+    a->next = b->arenas;
+    b->arenas = a;
+}
+
+// if zero is set the memory is cleared
+static void *alloc_big(size_t sz, int isobj, int zero)
+{
+    gc_ctx_t *ctx = gc_thread_ctx();
+    jl_gc_safepoint();
+    if (gc_over_limit(ctx, sz)) {
+        gc_collect(1);
+    }
+    else if (ctx->allocd_bytes > collect_interval) {
+        gc_collect(0);
     }
     sz = (sz+3) & -4;
-    allocd_bytes += sz;
+    ctx->allocd_bytes += sz;
     size_t offs = BVOFFS*sizeof(void*);
     if (sz + offs < offs)  // overflow in adding offs, size was "negative"
         jl_raise(jl_memory_exception);
-    bigval_t *v = (bigval_t*)malloc(sz + offs);
-    if (v == NULL)
-        jl_raise(jl_memory_exception);
+    bigval_t *v;
+    int huge = (sz >= GC_HUGE_SZ && sz <= BV_MAXBYTES);
+    int binned = 0;
+    if (huge) {
+        v = (bigval_t*)mmap(NULL, huge_mapsize(sz), PROT_READ|PROT_WRITE,
+                            MAP_PRIVATE|MAP_ANON, -1, 0);
+        if (v == MAP_FAILED)
+            jl_raise(jl_memory_exception);
+    }
+#ifndef MEMDEBUG
+    else if (sz < GC_HUGE_SZ) {
+        bigbin_t *b = &ctx->big_bins[big_binclass(sz + offs)];
+        if (b->freelist == NULL)
+            add_big_arena(b);
+        v = b->freelist;
+        b->freelist = v->next;
+        if (zero)
+            memset(&v->_data[0], 0, sz);
+        binned = 1;
+    }
+#endif
+    else {
+        v = (bigval_t*)(zero ? calloc(1, sz + offs) : malloc(sz + offs));
+        if (v == NULL)
+            jl_raise(jl_memory_exception);
+    }
 #if defined(MEMDEBUG) || defined(MEMPROFILE)
     v->sz = sz;
 #endif
-    v->next = big_objects;
     v->flags = 0;
     v->isobj = isobj;
-    big_objects = v;
+    v->huge = huge;
+    v->nbytes = (sz > BV_MAXBYTES ? BV_MAXBYTES : sz);
+    __sync_fetch_and_add(&heap_size, v->nbytes);
+    if (binned) {
+        v->next = NULL;
+    }
+    else {
+        v->next = ctx->big_objects;
+        ctx->big_objects = v;
+    }
     return &v->_data[0];
 }
 
@@ -246,44 +596,261 @@ void jl_gc_acquire_buffer(void *b)
 #if defined(MEMDEBUG) || defined(MEMPROFILE)
     v->sz = 0;  // ???
 #endif
-    v->next = big_objects;
+    gc_ctx_t *ctx = gc_thread_ctx();
+    v->next = ctx->big_objects;
     v->flags = 0;
     v->isobj = 0;
-    big_objects = v;
+    ctx->big_objects = v;
 }
 
 #define bigval_word0(v) (((uptrint_t*)(&((bigval_t*)(v))->_data[0]))[0])
 
-static void sweep_big(void)
+// objects that are in neither the pools nor the big object list are
+// symbols, which are never freed and so count as old.
+static int gc_isold(jl_value_t *v)
+{
+    if (in_pool_page(v))
+        return page_age(gc_page_of(v), v);
+    if (gc_typeof(v) == (jl_value_t*)jl_sym_type)
+        return 1;
+    return bigval_of(v)->old;
+}
+
+static void gc_clearold(jl_value_t *v)
+{
+    if (in_pool_page(v))
+        page_setage(gc_page_of(v), v, 0);
+    else if (gc_typeof(v) != (jl_value_t*)jl_sym_type)
+        bigval_of(v)->old = 0;
+}
+
+static int gc_always_rescan(jl_value_t *vt)
+{
+    return (vt == (jl_value_t*)jl_struct_kind || vt == (jl_value_t*)jl_tag_kind ||
+            vt == (jl_value_t*)jl_bits_kind ||
+            vt == (jl_value_t*)jl_typename_type ||
+            vt == (jl_value_t*)jl_methtable_type ||
+            vt == (jl_value_t*)jl_method_type ||
+            vt == (jl_value_t*)jl_lambda_info_type ||
+            vt == (jl_value_t*)jl_module_type ||
+            vt == (jl_value_t*)jl_task_type);
+}
+
+// write barrier slow path: parent had a reference stored into it. if it is
+// old it must be traced by the next minor collection; clearing its age
+// keeps it from being queued twice.
+DLLEXPORT void jl_gc_wb_slow(void *parent)
+{
+    jl_value_t *v = (jl_value_t*)parent;
+    if (gc_always_rescan((jl_value_t*)jl_typeof(v)))
+        return;
+    if (in_pool_page(v)) {
+        // ages are only up to date on swept pages
+        gcpage_t *pg = gc_page_of(v);
+        if (pg->unswept)
+            sweep_page(pg->pool, pg, 1);
+    }
+    if (!gc_isold(v))
+        return;
+    gc_clearold(v);
+    arraylist_push(&remset, v);
+}
+
+// a reshaped array shares the buffer of the array stored at the start of
+// its data area, and the elements are only scanned through that owner.
+// a store through a young view of an old owner must remember the owner.
+DLLEXPORT void jl_gc_wb_array_slow(jl_array_t *a)
+{
+    while (a->reshaped) {
+        int ndims = jl_array_ndims(a);
+        int ndimwords = (ndims > 2 ? (ndims-2) : 0);
+#ifndef __LP64__
+        ndimwords += (~ndimwords)&1;
+#endif
+        a = *(jl_array_t**)(&a->_space[0] + ndimwords*sizeof(size_t));
+    }
+    jl_gc_wb_slow(a);
+}
+
+// whether big object v survives this collection. clears its mark.
+static int sweep_bigval(bigval_t *v)
 {
-    bigval_t *v = big_objects;
-    bigval_t **pv = &big_objects;
+    if (v->isobj && (bigval_word0(v)&1)) {
+        bigval_word0(v) &= ~1UL;
+        v->old = 1;
+        return 1;
+    }
+    if (!v->isobj && v->marked) {
+        v->marked = 0;
+        v->old = 1;
+        return 1;
+    }
+    return (gc_minor && v->old);
+}
+
+// rebuilds the bin's free list in arena order. arenas left empty are
+// unmapped, except for one kept to absorb the next allocations.
+static size_t sweep_big_bin(bigbin_t *b)
+{
+    size_t nlive = 0;
+    int kept_empty = 0;
+    bigval_t *fl = NULL;
+    bigval_t **pfl = &fl;
+    bigarena_t *a = b->arenas;
+    bigarena_t **pa = &b->arenas;
+    while (a != NULL) {
+        bigarena_t *nxt = a->next;
+        bigval_t *afl = NULL;
+        bigval_t **pafl = &afl;
+        size_t i, nfree = 0;
+        for(i=0; i < a->nblocks; i++) {
+            bigval_t *v = arena_block(b, a, i);
+            if (v->nbytes != 0) {
+                if (sweep_bigval(v)) {
+                    nlive += v->nbytes;
+                    continue;
+                }
+                __sync_fetch_and_sub(&heap_size, v->nbytes);
+                v->flags = 0;
+                if (b->bsize >= GC_BIG_MADV_SZ) {
+                    char *lo = (char*)(((uptrint_t)&v->_data[0] +
+                                        jl_page_size-1) & ~(jl_page_size-1));
+                    char *hi = (char*)(((uptrint_t)v + b->bsize) &
+                                       ~(jl_page_size-1));
+                    if (hi > lo)
+                        madvise(lo, hi-lo, MADV_DONTNEED);
+                }
+            }
+            *pafl = v;
+            pafl = &v->next;
+            nfree++;
+        }
+        if (nfree == a->nblocks && kept_empty) {
+            *pa = nxt;
+            munmap(a, a->mapsize);
+        }
+        else {
+            if (nfree == a->nblocks)
+                kept_empty = 1;
+            if (afl != NULL) {
+                *pfl = afl;
+                pfl = pafl;
+            }
+            pa = &a->next;
+        }
+        a = nxt;
+    }
+    *pfl = NULL;
+    b->freelist = fl;
+    return nlive;
+}
+
+// returns the number of bytes kept
+static size_t sweep_big(gc_ctx_t *ctx)
+{
+    size_t nlive = 0;
+    int i;
+    for(i=0; i < N_BIG_BINS; i++)
+        nlive += sweep_big_bin(&ctx->big_bins[i]);
+    bigval_t *v = ctx->big_objects;
+    bigval_t **pv = &ctx->big_objects;
     while (v != NULL) {
         bigval_t *nxt = v->next;
-        if (v->isobj && (bigval_word0(v)&1)) {
-            pv = &v->next;
-            bigval_word0(v) &= ~1UL;
-        }
-        else if (!v->isobj && v->marked) {
+        if (sweep_bigval(v)) {
             pv = &v->next;
-            v->marked = 0;
+            nlive += v->nbytes;
         }
         else {
             *pv = nxt;
+            __sync_fetch_and_sub(&heap_size, v->nbytes);
 #ifdef MEMDEBUG
             memset(v, 0xbb, v->sz+BVOFFS*sizeof(void*));
 #endif
-            free(v);
+            if (v->huge)
+                munmap(v, huge_mapsize(v->nbytes));
+            else
+                free(v);
         }
         v = nxt;
     }
+    return nlive;
 }
 
-static void add_page(pool_t *p)
+// pages are carved out of mmapped arenas. freed pages go to a small cache
+// of resident pages, and past that are given back to the OS with madvise.
+// they keep their addresses, so the OS hands out zeroed memory if they are
+// reused.
+#define GC_ARENA_PAGES 64
+#define GC_PAGE_CACHE  64
+
+static gcpage_t *page_cache = NULL;
+static size_t n_cached_pages = 0;
+static arraylist_t released_pages;
+static pthread_mutex_t gc_page_mut = PTHREAD_MUTEX_INITIALIZER;
+
+static gcpage_t *alloc_page_(void)
 {
-    gcpage_t *pg = malloc(sizeof(gcpage_t));
-    if (pg == NULL)
+    gcpage_t *pg;
+    if (page_cache != NULL) {
+        pg = page_cache;
+        page_cache = pg->next;
+        n_cached_pages--;
+        return pg;
+    }
+    if (released_pages.len > 0)
+        return (gcpage_t*)arraylist_pop(&released_pages);
+    // map one page extra, so the arena can be trimmed to page alignment
+    size_t sz = (GC_ARENA_PAGES+1)*GC_PAGE_SZ;
+    char *mem = (char*)mmap(NULL, sz, PROT_READ|PROT_WRITE,
+                            MAP_PRIVATE|MAP_ANON, -1, 0);
+    if (mem == MAP_FAILED)
         jl_raise(jl_memory_exception);
+    char *start = (char*)(((uptrint_t)mem + GC_PAGE_SZ-1) &
+                          ~(uptrint_t)(GC_PAGE_SZ-1));
+    if (start > mem)
+        munmap(mem, start-mem);
+    if (start+GC_ARENA_PAGES*GC_PAGE_SZ < mem+sz)
+        munmap(start+GC_ARENA_PAGES*GC_PAGE_SZ,
+               (mem+sz)-(start+GC_ARENA_PAGES*GC_PAGE_SZ));
+    // keep the first page, release the rest for later
+    int i;
+    for(i=GC_ARENA_PAGES-1; i > 0; i--)
+        arraylist_push(&released_pages, start+i*GC_PAGE_SZ);
+    return (gcpage_t*)start;
+}
+
+static gcpage_t *alloc_page(void)
+{
+    pthread_mutex_lock(&gc_page_mut);
+    gcpage_t *pg = alloc_page_();
+    pthread_mutex_unlock(&gc_page_mut);
+    return pg;
+}
+
+static void release_page(gcpage_t *pg)
+{
+    pthread_mutex_lock(&gc_page_mut);
+    if (n_cached_pages < GC_PAGE_CACHE) {
+        pg->next = page_cache;
+        page_cache = pg;
+        n_cached_pages++;
+    }
+    else {
+        madvise(pg, GC_PAGE_SZ, MADV_DONTNEED);
+        arraylist_push(&released_pages, pg);
+    }
+    pthread_mutex_unlock(&gc_page_mut);
+}
+
+static void add_page(pool_t *p)
+{
+    gcpage_t *pg = alloc_page();
+    __sync_fetch_and_add(&heap_size, GC_PAGE_SZ);
+    pg->pool = p;
+    pg->unswept = 0;
+    memset(pg->marks, 0, sizeof(pg->marks));
+    memset(pg->age, 0, sizeof(pg->age));
+    pagemap_set(pg, 1);
     gcval_t *v = (gcval_t*)&pg->data[0];
     char *lim = (char*)pg + GC_PAGE_SZ - p->osize;
     gcval_t *fl;
@@ -301,13 +868,23 @@ static void add_page(pool_t *p)
     p->freelist = fl;
 }
 
-static void *pool_alloc(pool_t *p)
+static void *pool_alloc(gc_ctx_t *ctx, pool_t *p)
 {
-    if (allocd_bytes > collect_interval) {
-        jl_gc_collect();
+    if (ctx->allocd_bytes > collect_interval) {
+        gc_collect(0);
     }
-    if (p->freelist == NULL) {
-        add_page(p);
+    if (p->freelist == NULL)
+        jl_gc_safepoint();
+    while (p->freelist == NULL) {
+        if (!sweep_next_page(p)) {
+            if (gc_over_limit(ctx, GC_PAGE_SZ)) {
+                // this leaves everything unswept, so go around again
+                gc_collect(1);
+                continue;
+            }
+            add_page(p);
+            break;
+        }
     }
     assert(p->freelist != NULL);
     gcval_t *v = p->freelist;
@@ -316,77 +893,223 @@ static void *pool_alloc(pool_t *p)
     return v;
 }
 
-static void sweep_pool(pool_t *p)
+static void free_page(gcpage_t *pg)
+{
+    pagemap_set(pg, 0);
+    __sync_fetch_and_sub(&heap_size, GC_PAGE_SZ);
+#ifdef MEMDEBUG
+    memset(pg, 0xbb, sizeof(gcpage_t));
+#endif
+    release_page(pg);
+}
+
+// sweep one page, putting its free objects on the free list. returns 1 if
+// nothing on the page is live, in which case the free list is only
+// extended if keep is set.
+static int sweep_page(pool_t *p, gcpage_t *pg, int keep)
 {
-    //int empty;
-    int freedall;
-    gcval_t **prev_pfl;
-    gcval_t *v;
-    gcpage_t *pg = p->pages;
-    gcpage_t **ppg = &p->pages;
-    gcval_t **pfl = &p->freelist;
     size_t osize = p->osize;
+    char *lim = (char*)pg + GC_PAGE_SZ - osize;
+    gcval_t *v = (gcval_t*)&pg->data[0];
+    gcval_t *fl = NULL;
+    gcval_t **pfl = &fl;
+    int freedall = 1;
 
-    while (pg != NULL) {
-        char *lim = (char*)pg + GC_PAGE_SZ - osize;
-        v = (gcval_t*)&pg->data[0];
-        //empty = 1;
-        freedall = 1;
-        prev_pfl = pfl;
-        while ((char*)v <= lim) {
-            if (!v->marked) {
-                *pfl = v;
-                pfl = &v->next;
-            }
-            else {
-                v->marked = 0;
-                freedall = 0;
-            }
-            v = (gcval_t*)((char*)v + osize);
+    while ((char*)v <= lim) {
+        if (page_marked(pg, v)) {
+            if (jl_gc_generational) page_setage(pg, v, 1);
+            freedall = 0;
         }
-        gcpage_t *nextpg = pg->next;
-        // lazy version: (empty) if the whole page was already unused, free it
-        // eager version: (freedall) free page as soon as possible
-        // the eager one uses less memory.
-        if (freedall) {
-            pfl = prev_pfl;
-            *ppg = nextpg;
-#ifdef MEMDEBUG
-            memset(pg, 0xbb, sizeof(gcpage_t));
-#endif
-            free(pg);
+        else if (sweep_minor && page_age(pg, v)) {
+            freedall = 0;
         }
         else {
-            ppg = &pg->next;
+            if (jl_gc_generational) page_setage(pg, v, 0);
+            *pfl = v;
+            pfl = &v->next;
+        }
+        v = (gcval_t*)((char*)v + osize);
+    }
+    memset(pg->marks, 0, sizeof(pg->marks));
+    pg->unswept = 0;
+    // eager policy: free a page as soon as all of it is garbage. this uses
+    // less memory than waiting for a page that was already unused.
+    if (!freedall || keep) {
+        *pfl = p->freelist;
+        p->freelist = fl;
+    }
+    return freedall;
+}
+
+// sweep the next page of p left over from the last collection. returns 0
+// if there are none.
+static int sweep_next_page(pool_t *p)
+{
+    gcpage_t *pg = p->unswept;
+    if (pg == NULL)
+        return 0;
+    p->unswept = pg->next;
+    // pages swept early by the write barrier are only moved back
+    if (pg->unswept && sweep_page(p, pg, 0)) {
+        free_page(pg);
+    }
+    else {
+        pg->next = p->pages;
+        p->pages = pg;
+    }
+    return 1;
+}
+
+// pools are swept lazily: a collection only hands every page to the
+// unswept list, and pool_alloc sweeps pages as it needs free objects.
+static size_t sweep_pool(pool_t *p)
+{
+    assert(p->unswept == NULL);
+    gcpage_t *pg;
+    size_t i, nlive = 0;
+    for(pg = p->pages; pg != NULL; pg = pg->next) {
+        pg->unswept = 1;
+        // count what the lazy sweep will keep
+        for(i=0; i < GC_PAGE_NGRAN/32; i++) {
+            uint32_t keep = pg->marks[i];
+            if (sweep_minor) keep |= pg->age[i];
+            nlive += __builtin_popcount(keep);
+        }
+    }
+    p->freelist = NULL;
+    p->unswept = p->pages;
+    p->pages = NULL;
+    return nlive * p->osize;
+}
+
+// marking reuses the page mark bitmaps, so whatever the mutator did not
+// sweep is swept before a collection.
+static void gc_finish_sweep(void)
+{
+    gc_ctx_t *ctx;
+    int i;
+    for(ctx = gc_ctxs; ctx != NULL; ctx = ctx->next) {
+        for(i=0; i < N_POOLS; i++) {
+            while (sweep_next_page(&ctx->norm_pools[i]))
+                ;
+            while (sweep_next_page(&ctx->ephe_pools[i]))
+                ;
         }
-        pg = nextpg;
     }
-    *pfl = NULL;
 }
 
 extern void jl_unmark_symbols(void);
 
 static void gc_sweep(void)
 {
-    sweep_big();
+    gc_ctx_t *ctx;
     int i;
-    for(i=0; i < N_POOLS; i++) {
-        sweep_pool(&norm_pools[i]);
-        sweep_pool(&ephe_pools[i]);
+    sweep_minor = gc_minor;
+    gc_st.big_live = 0;
+    for(i=0; i < N_POOLS; i++)
+        gc_st.pool_live[i] = 0;
+    for(ctx = gc_ctxs; ctx != NULL; ctx = ctx->next) {
+        gc_st.big_live += sweep_big(ctx);
+        for(i=0; i < N_POOLS; i++) {
+            gc_st.pool_live[i] += sweep_pool(&ctx->norm_pools[i]) +
+                sweep_pool(&ctx->ephe_pools[i]);
+        }
     }
+    live_bytes = gc_st.big_live;
+    for(i=0; i < N_POOLS; i++)
+        live_bytes += gc_st.pool_live[i];
     jl_unmark_symbols();
 }
 
-#define GC_Markval(v) gc_markval_((jl_value_t*)(v))
-static void gc_markval_(jl_value_t *v);
+static void gc_update_interval(void)
+{
+    double next = live_bytes * gc_heap_mult;
+    if (next < (double)gc_interval_min)
+        collect_interval = gc_interval_min;
+    else if (next > (double)gc_interval_max)
+        collect_interval = gc_interval_max;
+    else
+        collect_interval = (size_t)next;
+}
+
+// marking uses an explicit stack of objects that are marked but whose
+// children have not been scanned yet. with JULIA_GC_THREADS > 1, the stack
+// is drained by several marker threads, which hand work to each other
+// through a shared pool.
+
+static arraylist_t mark_stack;
+
+#define GC_Markval(ms,v) gc_push_(ms, (jl_value_t*)(v))
+
+static int gc_nmarkers = 1;
+static pthread_mutex_t gc_mark_mut;
+static pthread_cond_t gc_mark_cond;    // a parallel mark is starting
+static pthread_cond_t gc_work_cond;    // shared work or termination
+static pthread_cond_t gc_done_cond;    // a marker thread finished
+static arraylist_t gc_shared_work;
+static volatile int gc_idle = 0;       // markers waiting for work
+static int gc_nrunning = 0;            // marker threads still running
+static int gc_mark_epoch = 0;
+#define GC_DONATE_MIN  64              // keep at least this many items
+#define GC_STEAL_MAX   256             // take at most this many items
+
+static inline int page_trymark(gcpage_t *pg, void *v)
+{
+    size_t i = gc_gran(pg, v);
+    uint32_t bit = 1U<<(i&31);
+    if (gc_nmarkers > 1)
+        return !(__sync_fetch_and_or(&pg->marks[i>>5], bit) & bit);
+    if (pg->marks[i>>5] & bit) return 0;
+    pg->marks[i>>5] |= bit;
+    return 1;
+}
+
+// set the mark bit of an object, returning 0 if it was already set
+static inline int gc_trymark_obj(jl_value_t *v)
+{
+    if (in_pool_page(v))
+        return page_trymark(gc_page_of(v), v);
+    if (gc_nmarkers > 1)
+        return !(__sync_fetch_and_or((uptrint_t*)v, 1) & 1);
+    if (((gcval_t*)v)->marked) return 0;
+    ((gcval_t*)v)->marked = 1;
+    return 1;
+}
+
+static inline void gc_setmark_buf(void *b)
+{
+    gcval_t *slot = gc_val(b);
+    if (in_pool_page(slot))
+        page_trymark(gc_page_of(slot), slot);
+    else if (gc_nmarkers > 1)
+        __sync_fetch_and_or(&slot->flags, 1);
+    else
+        slot->marked = 1;
+}
+
+void jl_gc_setmark(void *b)
+{
+    gc_setmark_buf(b);
+}
+
+static inline void gc_push_(arraylist_t *ms, jl_value_t *v)
+{
+    assert(v != NULL);
+    //assert(v != lookforme);
+    if (gc_marked_obj(v)) return;
+    // a minor collection does not trace old objects
+    if (gc_minor && gc_isold(v)) return;
+    if (gc_trymark_obj(v))
+        arraylist_push(ms, v);
+}
 
 void jl_gc_markval(jl_value_t *v)
 {
-    gc_markval_(v);
+    gc_push_(&mark_stack, v);
 }
 
 #ifdef COPY_STACKS
-static void gc_mark_stack(jl_gcframe_t *s, ptrint_t offset)
+static void gc_mark_stack(arraylist_t *ms, jl_gcframe_t *s, ptrint_t offset)
 {
     while (s != NULL) {
         s = (jl_gcframe_t*)((char*)s + offset);
@@ -396,33 +1119,33 @@ static void gc_mark_stack(jl_gcframe_t *s, ptrint_t offset)
             for(i=0; i < s->nroots; i++) {
                 jl_value_t **ptr = (jl_value_t**)((char*)rts[i] + offset);
                 if (*ptr != NULL)
-                    GC_Markval(*ptr);
+                    GC_Markval(ms, *ptr);
             }
         }
         else {
             for(i=0; i < s->nroots; i++) {
                 if (rts[i] != NULL)
-                    GC_Markval(rts[i]);
+                    GC_Markval(ms, rts[i]);
             }
         }
         s = s->prev;
     }
 }
 #else
-static void gc_mark_stack(jl_gcframe_t *s)
+static void gc_mark_stack(arraylist_t *ms, jl_gcframe_t *s)
 {
     while (s != NULL) {
         size_t i;
         if (s->indirect) {
             for(i=0; i < s->nroots; i++) {
                 if (*s->roots[i] != NULL)
-                    GC_Markval(*s->roots[i]);
+                    GC_Markval(ms, *s->roots[i]);
             }
         }
         else {
             for(i=0; i < s->nroots; i++) {
                 if (s->roots[i] != NULL)
-                    GC_Markval(s->roots[i]);
+                    GC_Markval(ms, s->roots[i]);
             }
         }
         s = s->prev;
@@ -430,41 +1153,37 @@ static void gc_mark_stack(jl_gcframe_t *s)
 }
 #endif
 
-static void gc_mark_module(jl_module_t *m)
+static void gc_mark_module(arraylist_t *ms, jl_module_t *m)
 {
     size_t i;
     void **table = m->bindings.table;
     for(i=1; i < m->bindings.size; i+=2) {
         if (table[i] != HT_NOTFOUND) {
             jl_binding_t *b = (jl_binding_t*)table[i];
-            gc_setmark(b);
+            gc_setmark_buf(b);
             if (b->value != NULL)
-                GC_Markval(b->value);
-            GC_Markval(b->type);
+                GC_Markval(ms, b->value);
+            GC_Markval(ms, b->type);
         }
     }
     table = m->macros.table;
     for(i=1; i < m->macros.size; i+=2) {
         if (table[i] != HT_NOTFOUND) {
-            GC_Markval((jl_value_t*)table[i]);
+            GC_Markval(ms, (jl_value_t*)table[i]);
         }
     }
 }
 
-#define gc_typeof(v) ((jl_value_t*)(((uptrint_t)jl_typeof(v))&~1UL))
-
 // for chasing down unwanted references
 /*
 static jl_value_t *lookforme = NULL;
 DLLEXPORT void jl_gc_lookfor(jl_value_t *v) { lookforme = v; }
 */
 
-static void gc_markval_(jl_value_t *v)
+// push the children of a marked object
+static void gc_scanobj(arraylist_t *ms, jl_value_t *v)
 {
-    assert(v != NULL);
-    //assert(v != lookforme);
-    if (gc_marked_obj(v)) return;
-    jl_value_t *vt = (jl_value_t*)jl_typeof(v);
+    jl_value_t *vt = gc_typeof(v);
 #ifdef OBJPROFILE
     void **bp = ptrhash_bp(&obj_counts, vt);
     if (*bp == HT_NOTFOUND)
@@ -473,7 +1192,12 @@ static void gc_markval_(jl_value_t *v)
         (*((ptrint_t*)bp))++;
 #endif
     jl_value_t *vtt = gc_typeof(vt);
-    gc_setmark_obj(v);
+    if (jl_gc_generational && gc_always_rescan(vt) &&
+        !(gc_minor && gc_isold(v))) {
+        if (gc_nmarkers > 1) pthread_mutex_lock(&gc_mark_mut);
+        arraylist_push(&rescan_objs, v);
+        if (gc_nmarkers > 1) pthread_mutex_unlock(&gc_mark_mut);
+    }
 
     if (vtt==(jl_value_t*)jl_bits_kind) return;
 
@@ -483,13 +1207,13 @@ static void gc_markval_(jl_value_t *v)
         for(i=0; i < ((jl_tuple_t*)v)->length; i++) {
             jl_value_t *elt = ((jl_tuple_t*)v)->data[i];
             if (elt != NULL)
-                GC_Markval(elt);
+                GC_Markval(ms, elt);
         }
     }
     else if (vtt == (jl_value_t*)jl_func_kind) {
         jl_function_t *f = (jl_function_t*)v;
-        if (f->env  !=NULL) GC_Markval(f->env);
-        if (f->linfo!=NULL) GC_Markval(f->linfo);
+        if (f->env  !=NULL) GC_Markval(ms, f->env);
+        if (f->linfo!=NULL) GC_Markval(ms, f->linfo);
     }
     else if (((jl_struct_type_t*)(vt))->name == jl_array_typename) {
         jl_array_t *a = (jl_array_t*)v;
@@ -501,13 +1225,13 @@ static void gc_markval_(jl_value_t *v)
 #endif
         void *data_area = &a->_space[0] + ndimwords*sizeof(size_t);
         if (a->reshaped) {
-            GC_Markval(*((jl_value_t**)data_area));
+            GC_Markval(ms, *((jl_value_t**)data_area));
         }
         else if (a->data) {
             char *data = a->data;
             if (ndims == 1) data -= a->offset*a->elsize;
             if (data != data_area) {
-                gc_setmark(data);
+                gc_setmark_buf(data);
             }
         }
         jl_value_t *elty = jl_tparam0(vt);
@@ -515,46 +1239,46 @@ static void gc_markval_(jl_value_t *v)
             size_t i;
             for(i=0; i < a->length; i++) {
                 jl_value_t *elt = ((jl_value_t**)a->data)[i];
-                if (elt != NULL) GC_Markval(elt);
+                if (elt != NULL) GC_Markval(ms, elt);
             }
         }
     }
     else if (vt == (jl_value_t*)jl_module_type) {
-        gc_mark_module((jl_module_t*)v);
+        gc_mark_module(ms, (jl_module_t*)v);
     }
     else if (vt == (jl_value_t*)jl_task_type) {
         jl_task_t *ta = (jl_task_t*)v;
-        GC_Markval(ta->on_exit);
-        GC_Markval(ta->tls);
+        GC_Markval(ms, ta->on_exit);
+        GC_Markval(ms, ta->tls);
         if (ta->start)
-            GC_Markval(ta->start);
+            GC_Markval(ms, ta->start);
         if (ta->result)
-            GC_Markval(ta->result);
-        GC_Markval(ta->state.eh_task);
+            GC_Markval(ms, ta->result);
+        GC_Markval(ms, ta->state.eh_task);
         if (ta->stkbuf != NULL)
-            gc_setmark(ta->stkbuf);
+            gc_setmark_buf(ta->stkbuf);
 #ifdef COPY_STACKS
         ptrint_t offset;
         if (ta == jl_current_task) {
             offset = 0;
-            gc_mark_stack(jl_pgcstack, offset);
+            gc_mark_stack(ms, jl_pgcstack, offset);
         }
         else {
             offset = ta->stkbuf - (ta->stackbase-ta->ssize);
-            gc_mark_stack(ta->state.gcstack, offset);
+            gc_mark_stack(ms, ta->state.gcstack, offset);
         }
         jl_savestate_t *ss = &ta->state;
         while (ss != NULL) {
-            GC_Markval(ss->ostream_obj);
+            GC_Markval(ms, ss->ostream_obj);
             ss = ss->prev;
             if (ss != NULL)
                 ss = (jl_savestate_t*)((char*)ss + offset);
         }
 #else
-        gc_mark_stack(ta->state.gcstack);
+        gc_mark_stack(ms, ta->state.gcstack);
         jl_savestate_t *ss = &ta->state;
         while (ss != NULL) {
-            GC_Markval(ss->ostream_obj);
+            GC_Markval(ms, ss->ostream_obj);
             ss = ss->prev;
         }
 #endif
@@ -574,68 +1298,212 @@ static void gc_markval_(jl_value_t *v)
         for(; i < nf; i++) {
             jl_value_t *fld = ((jl_value_t**)v)[i+1];
             if (fld)
-                GC_Markval(fld);
+                GC_Markval(ms, fld);
         }
     }
 }
 
+// move the oldest half of a marker's stack to the shared pool, for idle
+// markers to pick up
+static void gc_donate_work(arraylist_t *ms)
+{
+    size_t n = ms->len/2;
+    pthread_mutex_lock(&gc_mark_mut);
+    size_t i;
+    for(i=0; i < n; i++)
+        arraylist_push(&gc_shared_work, ms->items[i]);
+    pthread_cond_broadcast(&gc_work_cond);
+    pthread_mutex_unlock(&gc_mark_mut);
+    memmove(&ms->items[0], &ms->items[n], (ms->len-n)*sizeof(void*));
+    ms->len -= n;
+}
+
+static void gc_drain(arraylist_t *ms)
+{
+    while (ms->len > 0) {
+        jl_value_t *v = (jl_value_t*)arraylist_pop(ms);
+        gc_scanobj(ms, v);
+        if (gc_nmarkers > 1 && gc_idle > 0 && ms->len > GC_DONATE_MIN &&
+            gc_shared_work.len == 0)
+            gc_donate_work(ms);
+    }
+}
+
+// run by every marker until all stacks and the shared pool are empty
+static void gc_mark_parallel(arraylist_t *ms)
+{
+    while (1) {
+        gc_drain(ms);
+        pthread_mutex_lock(&gc_mark_mut);
+        gc_idle++;
+        while (gc_shared_work.len == 0 && gc_idle < gc_nmarkers)
+            pthread_cond_wait(&gc_work_cond, &gc_mark_mut);
+        if (gc_shared_work.len == 0) {
+            // every marker is idle: done
+            pthread_cond_broadcast(&gc_work_cond);
+            pthread_mutex_unlock(&gc_mark_mut);
+            return;
+        }
+        gc_idle--;
+        size_t n = gc_shared_work.len;
+        if (n > GC_STEAL_MAX) n = GC_STEAL_MAX;
+        while (n-- > 0)
+            arraylist_push(ms, arraylist_pop(&gc_shared_work));
+        pthread_mutex_unlock(&gc_mark_mut);
+    }
+}
+
+static void *gc_marker_thread(void *arg)
+{
+    sigset_t set;
+    sigfillset(&set);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+    arraylist_t ms;
+    arraylist_new(&ms, 0);
+    int epoch = 0;
+    while (1) {
+        pthread_mutex_lock(&gc_mark_mut);
+        while (gc_mark_epoch == epoch)
+            pthread_cond_wait(&gc_mark_cond, &gc_mark_mut);
+        epoch = gc_mark_epoch;
+        pthread_mutex_unlock(&gc_mark_mut);
+
+        gc_mark_parallel(&ms);
+
+        pthread_mutex_lock(&gc_mark_mut);
+        gc_nrunning--;
+        pthread_cond_signal(&gc_done_cond);
+        pthread_mutex_unlock(&gc_mark_mut);
+    }
+    return NULL;
+}
+
+static void gc_start_markers(int n)
+{
+    pthread_mutex_init(&gc_mark_mut, NULL);
+    pthread_cond_init(&gc_mark_cond, NULL);
+    pthread_cond_init(&gc_work_cond, NULL);
+    pthread_cond_init(&gc_done_cond, NULL);
+    arraylist_new(&gc_shared_work, 0);
+    int i;
+    for(i=1; i < n; i++) {
+        pthread_t t;
+        if (pthread_create(&t, NULL, gc_marker_thread, NULL) != 0)
+            break;
+        pthread_detach(t);
+    }
+    gc_nmarkers = i;
+}
+
+// mark everything reachable from the main mark stack
+static void gc_mark_all(void)
+{
+    if (gc_nmarkers == 1) {
+        gc_drain(&mark_stack);
+        return;
+    }
+    pthread_mutex_lock(&gc_mark_mut);
+    gc_idle = 0;
+    gc_nrunning = gc_nmarkers-1;
+    gc_mark_epoch++;
+    pthread_cond_broadcast(&gc_mark_cond);
+    pthread_mutex_unlock(&gc_mark_mut);
+
+    gc_mark_parallel(&mark_stack);
+
+    pthread_mutex_lock(&gc_mark_mut);
+    while (gc_nrunning > 0)
+        pthread_cond_wait(&gc_done_cond, &gc_mark_mut);
+    // keeps later sequential drains from donating work
+    gc_idle = 0;
+    pthread_mutex_unlock(&gc_mark_mut);
+}
+
 void jl_mark_box_caches(void);
+void jl_mark_gf_profile(void);
+void jl_mark_type_memo(void);
 
 extern jl_value_t * volatile jl_task_arg_in_transit;
-#ifdef GCTIME
 double clock_now(void);
-#endif
 
 static void gc_mark(void)
 {
+    arraylist_t *ms = &mark_stack;
     // mark all roots
 
     // active tasks
-    GC_Markval(jl_root_task);
-    GC_Markval(jl_current_task);
+    GC_Markval(ms, jl_root_task);
+    GC_Markval(ms, jl_current_task);
 
     // modules
-    GC_Markval(jl_base_module);
-    GC_Markval(jl_current_module);
+    GC_Markval(ms, jl_base_module);
+    GC_Markval(ms, jl_current_module);
 
     // invisible builtin values
-    GC_Markval(jl_methtable_type);
-    GC_Markval(jl_method_type);
-    GC_Markval(jl_any_func);
-    if (jl_an_empty_cell) GC_Markval(jl_an_empty_cell);
-    GC_Markval(jl_exception_in_transit);
-    GC_Markval(jl_task_arg_in_transit);
-    GC_Markval(jl_unprotect_stack_func);
-    GC_Markval(jl_typetype_type);
+    GC_Markval(ms, jl_methtable_type);
+    GC_Markval(ms, jl_method_type);
+    GC_Markval(ms, jl_any_func);
+    if (jl_an_empty_cell) GC_Markval(ms, jl_an_empty_cell);
+    GC_Markval(ms, jl_exception_in_transit);
+    GC_Markval(ms, jl_task_arg_in_transit);
+    GC_Markval(ms, jl_unprotect_stack_func);
+    GC_Markval(ms, jl_typetype_type);
 
     // constants
-    GC_Markval(jl_null);
-    GC_Markval(jl_true);
-    GC_Markval(jl_false);
+    GC_Markval(ms, jl_null);
+    GC_Markval(ms, jl_true);
+    GC_Markval(ms, jl_false);
 
     jl_mark_box_caches();
+    jl_mark_gf_profile();
+    jl_mark_type_memo();
 
     size_t i;
 
+    if (gc_minor) {
+        // old objects that may point to young ones
+        for(i=0; i < remset.len; i++) {
+            GC_Markval(ms, remset.items[i]);
+        }
+        size_t n = rescan_objs.len;
+        for(i=0; i < n; i++) {
+            jl_value_t *v = (jl_value_t*)rescan_objs.items[i];
+            if (gc_trymark_obj(v))
+                arraylist_push(ms, v);
+        }
+    }
+
     // stuff randomly preserved
     for(i=0; i < preserved_values.len; i++) {
-        GC_Markval((jl_value_t*)preserved_values.items[i]);
+        GC_Markval(ms, preserved_values.items[i]);
     }
 
     // objects currently being finalized
     for(i=0; i < to_finalize.len; i++) {
-        GC_Markval(to_finalize.items[i]);
+        GC_Markval(ms, to_finalize.items[i]);
+    }
+
+    // types recorded by the allocation profiler
+    for(i=0; i < n_alloc_samples; i++) {
+        if (alloc_samples[i].type != NULL)
+            GC_Markval(ms, alloc_samples[i].type);
     }
+
+    gc_mark_all();
+
     // find unmarked objects that need to be finalized.
     // this must happen last.
     for(i=0; i < finalizer_table.size; i+=2) {
         if (finalizer_table.table[i+1] != HT_NOTFOUND) {
             jl_value_t *v = finalizer_table.table[i];
-            if (!gc_marked_obj(v)) {
-                GC_Markval(v);
+            if (!gc_marked_obj(v) && !(gc_minor && gc_isold(v))) {
+                GC_Markval(ms, v);
+                gc_drain(ms);
                 schedule_finalization(v);
             }
-            GC_Markval(finalizer_table.table[i+1]);
+            GC_Markval(ms, finalizer_table.table[i+1]);
+            gc_drain(ms);
         }
     }
 }
@@ -645,8 +1513,225 @@ DLLEXPORT void jl_gc_enable(void)    { is_gc_enabled = 1; }
 DLLEXPORT void jl_gc_disable(void)   { is_gc_enabled = 0; }
 DLLEXPORT int jl_gc_is_enabled(void) { return is_gc_enabled; }
 
-void jl_gc_ephemeral_on(void)  { pools = &ephe_pools[0]; }
-void jl_gc_ephemeral_off(void) { pools = &norm_pools[0]; }
+DLLEXPORT void jl_gc_set_generational(int on)
+{
+    // object ages are only maintained in generational mode, so they
+    // need to be recomputed by a full collection first
+    if (on && !jl_gc_generational)
+        gc_full_pending = 1;
+    jl_gc_generational = on;
+}
+
+// arguments that are 0 leave the corresponding setting alone
+DLLEXPORT void jl_gc_set_policy(double mult, size_t min, size_t max)
+{
+    if (mult > 0)
+        gc_heap_mult = mult;
+    if (min > 0)
+        gc_interval_min = min;
+    if (max > 0)
+        gc_interval_max = max;
+    if (gc_interval_max < gc_interval_min)
+        gc_interval_max = gc_interval_min;
+    gc_update_interval();
+}
+
+// 0 turns the limit off
+DLLEXPORT void jl_gc_set_heap_limit(size_t bytes)
+{
+    gc_heap_limit = bytes;
+}
+
+DLLEXPORT int jl_gc_npools(void) { return N_POOLS; }
+
+DLLEXPORT int jl_gc_npauses(void)
+{
+    return gc_st.ncollect < GC_NPAUSES ? gc_st.ncollect : GC_NPAUSES;
+}
+
+// counts gets collections, minor collections, finalizers run, bytes
+// allocated, live bytes and big object bytes. times gets total pause, max
+// pause, mark time and sweep time. pools gets the object size and live
+// bytes of each size class, and pauses the last jl_gc_npauses() pause
+// times, oldest first.
+DLLEXPORT void jl_gc_get_stats(size_t *counts, double *times, size_t *pools,
+                               double *pauses)
+{
+    int i;
+    counts[0] = gc_st.ncollect;
+    counts[1] = gc_st.nminor;
+    counts[2] = gc_st.nfinalized;
+    counts[3] = gc_st.allocd_total;
+    gc_ctx_t *ctx;
+    for(ctx = gc_ctxs; ctx != NULL; ctx = ctx->next)
+        counts[3] += ctx->allocd_bytes;
+    counts[4] = live_bytes;
+    counts[5] = gc_st.big_live;
+    times[0] = gc_st.pause_total;
+    times[1] = gc_st.pause_max;
+    times[2] = gc_st.mark_total;
+    times[3] = gc_st.sweep_total;
+    for(i=0; i < N_POOLS; i++) {
+        pools[2*i]   = pool_osize[i];
+        pools[2*i+1] = gc_st.pool_live[i];
+    }
+    int n = jl_gc_npauses();
+    for(i=0; i < n; i++)
+        pauses[i] = gc_st.pauses[(gc_st.ncollect-n+i) % GC_NPAUSES];
+}
+
+void jl_gc_ephemeral_on(void)
+{
+    gc_ctx_t *ctx = gc_thread_ctx();
+    ctx->pools = &ctx->ephe_pools[0];
+}
+
+void jl_gc_ephemeral_off(void)
+{
+    gc_ctx_t *ctx = gc_thread_ctx();
+    ctx->pools = &ctx->norm_pools[0];
+}
+
+static void gc_ctx_init(gc_ctx_t *ctx)
+{
+    int i;
+    for(i=0; i < N_POOLS; i++) {
+        ctx->norm_pools[i].osize = pool_osize[i];
+        ctx->norm_pools[i].pages = NULL;
+        ctx->norm_pools[i].unswept = NULL;
+        ctx->norm_pools[i].freelist = NULL;
+
+        ctx->ephe_pools[i].osize = pool_osize[i];
+        ctx->ephe_pools[i].pages = NULL;
+        ctx->ephe_pools[i].unswept = NULL;
+        ctx->ephe_pools[i].freelist = NULL;
+    }
+    ctx->pools = &ctx->norm_pools[0];
+    for(i=0; i < N_BIG_BINS; i++) {
+        ctx->big_bins[i].bsize = big_bin_size(i);
+        ctx->big_bins[i].arenas = NULL;
+        ctx->big_bins[i].freelist = NULL;
+    }
+    ctx->big_objects = NULL;
+    ctx->allocd_bytes = 0;
+    ctx->owned = 1;
+    ctx->safe = 0;
+}
+
+// a thread other than the main one must call this before allocating. its
+// objects have to be reachable from the main thread's roots whenever it
+// passes a safepoint.
+DLLEXPORT void jl_gc_register_thread(void)
+{
+    gc_ctx_t *ctx;
+    pthread_mutex_lock(&gc_ctx_mut);
+    // reuse the context of a thread that exited, along with its heap
+    for(ctx = gc_ctxs; ctx != NULL; ctx = ctx->next) {
+        if (!ctx->owned)
+            break;
+    }
+    if (ctx == NULL) {
+        ctx = (gc_ctx_t*)malloc(sizeof(gc_ctx_t));
+        if (ctx == NULL) {
+            pthread_mutex_unlock(&gc_ctx_mut);
+            jl_raise(jl_memory_exception);
+        }
+        gc_ctx_init(ctx);
+        ctx->next = gc_ctxs;
+        gc_ctxs = ctx;
+    }
+    ctx->owned = 1;
+    ctx->safe = 0;
+    n_gc_threads++;
+    // don't start allocating in the middle of a collection
+    while (gc_stop_world)
+        pthread_cond_wait(&gc_resume_cond, &gc_ctx_mut);
+    pthread_mutex_unlock(&gc_ctx_mut);
+    gc_ctx = ctx;
+}
+
+DLLEXPORT void jl_gc_unregister_thread(void)
+{
+    gc_ctx_t *ctx = gc_thread_ctx();
+    pthread_mutex_lock(&gc_ctx_mut);
+    ctx->owned = 0;
+    ctx->safe = 1;
+    n_gc_threads--;
+    pthread_cond_signal(&gc_safe_cond);
+    pthread_mutex_unlock(&gc_ctx_mut);
+    gc_ctx = NULL;
+}
+
+// mark the current thread as not touching the heap, e.g. around blocking
+// system calls, so collections do not wait for it
+DLLEXPORT void jl_gc_safe_enter(void)
+{
+    if (n_gc_threads == 1)
+        return;
+    gc_ctx_t *ctx = gc_thread_ctx();
+    pthread_mutex_lock(&gc_ctx_mut);
+    ctx->safe = 1;
+    pthread_cond_signal(&gc_safe_cond);
+    pthread_mutex_unlock(&gc_ctx_mut);
+}
+
+DLLEXPORT void jl_gc_safe_leave(void)
+{
+    if (n_gc_threads == 1)
+        return;
+    gc_ctx_t *ctx = gc_thread_ctx();
+    pthread_mutex_lock(&gc_ctx_mut);
+    while (gc_stop_world)
+        pthread_cond_wait(&gc_resume_cond, &gc_ctx_mut);
+    ctx->safe = 0;
+    pthread_mutex_unlock(&gc_ctx_mut);
+}
+
+static void gc_wait_for_collection(void)
+{
+    gc_ctx_t *ctx = gc_thread_ctx();
+    pthread_mutex_lock(&gc_ctx_mut);
+    ctx->safe = 1;
+    pthread_cond_signal(&gc_safe_cond);
+    while (gc_stop_world)
+        pthread_cond_wait(&gc_resume_cond, &gc_ctx_mut);
+    ctx->safe = 0;
+    pthread_mutex_unlock(&gc_ctx_mut);
+}
+
+DLLEXPORT void jl_gc_safepoint(void)
+{
+    if (__unlikely(gc_stop_world))
+        gc_wait_for_collection();
+}
+
+// returns 0 if another thread collected while we waited, in which case
+// there is nothing left to do
+static int gc_stop_the_world(void)
+{
+    pthread_mutex_lock(&gc_ctx_mut);
+    if (gc_stop_world) {
+        pthread_mutex_unlock(&gc_ctx_mut);
+        gc_wait_for_collection();
+        return 0;
+    }
+    gc_stop_world = 1;
+    gc_ctx_t *ctx;
+    for(ctx = gc_ctxs; ctx != NULL; ctx = ctx->next) {
+        while (ctx != gc_ctx && ctx->owned && !ctx->safe)
+            pthread_cond_wait(&gc_safe_cond, &gc_ctx_mut);
+    }
+    pthread_mutex_unlock(&gc_ctx_mut);
+    return 1;
+}
+
+static void gc_resume_the_world(void)
+{
+    pthread_mutex_lock(&gc_ctx_mut);
+    gc_stop_world = 0;
+    pthread_cond_broadcast(&gc_resume_cond);
+    pthread_mutex_unlock(&gc_ctx_mut);
+}
 
 #if defined(MEMPROFILE)
 static void all_pool_stats(void);
@@ -675,30 +1760,148 @@ static void print_obj_profile(void)
 }
 #endif
 
-void jl_gc_collect(void)
+size_t jl_unw_stack(size_t *data, size_t maxsize);
+jl_value_t *jl_decode_stack(size_t *data, size_t n);
+
+static void gc_resolve_sample(void)
+{
+    jl_value_t *v = alloc_sample_pending;
+    if (v == NULL)
+        return;
+    alloc_sample_pending = NULL;
+    // gc_sample_alloc cleared the type word, in case a collection
+    // happens before the caller stores the type
+    jl_value_t *t = (jl_value_t*)jl_typeof(v);
+    if (t != NULL && jl_is_type(t))
+        alloc_samples[n_alloc_samples-1].type = t;
+}
+
+static void gc_sample_alloc(void *v, size_t sz, int isobj)
+{
+    alloc_sample_left = alloc_sample_period;
+    gc_resolve_sample();
+    if (n_alloc_samples == max_alloc_samples) {
+        size_t newsz = max_alloc_samples ? max_alloc_samples*2 : 1024;
+        alloc_sample_t *ns =
+            (alloc_sample_t*)realloc(alloc_samples,
+                                     newsz*sizeof(alloc_sample_t));
+        if (ns == NULL)
+            return;
+        alloc_samples = ns;
+        max_alloc_samples = newsz;
+    }
+    alloc_sample_t *s = &alloc_samples[n_alloc_samples++];
+    s->type = NULL;
+    s->sz = sz;
+    s->nframes = jl_unw_stack(s->frames, ALLOC_BT_MAX);
+    if (isobj) {
+        *(jl_value_t**)v = NULL;
+        alloc_sample_pending = (jl_value_t*)v;
+    }
+}
+
+static inline void *gc_sampled(void *v, size_t sz, int isobj)
+{
+    if (__unlikely(alloc_sample_period) && --alloc_sample_left == 0)
+        gc_sample_alloc(v, sz, isobj);
+    return v;
+}
+
+DLLEXPORT void jl_gc_alloc_profile(size_t period)
+{
+    alloc_sample_period = period;
+    alloc_sample_left = period;
+}
+
+DLLEXPORT void jl_gc_alloc_profile_clear(void)
+{
+    alloc_sample_pending = NULL;
+    n_alloc_samples = 0;
+}
+
+// returns the samples as (type, size, stack) tuples, where type is
+// nothing for buffers and the stack is in the format of backtraces
+DLLEXPORT jl_value_t *jl_gc_alloc_samples(void)
+{
+    size_t period = alloc_sample_period;
+    jl_array_t *a = NULL;
+    jl_value_t *bt = NULL, *sz = NULL;
+    size_t i;
+    gc_resolve_sample();
+    alloc_sample_period = 0;
+    JL_GC_PUSH(&a, &bt, &sz);
+    a = jl_alloc_cell_1d(n_alloc_samples);
+    for(i=0; i < n_alloc_samples; i++) {
+        alloc_sample_t *s = &alloc_samples[i];
+        bt = jl_decode_stack(s->frames, s->nframes);
+        sz = jl_box_long(s->sz);
+        jl_arrayset(a, i, (jl_value_t*)
+                    jl_tuple(3, s->type ? s->type : jl_nothing, sz, bt));
+    }
+    JL_GC_POP();
+    alloc_sample_period = period;
+    return (jl_value_t*)a;
+}
+
+static void gc_collect(int full)
 {
-    allocd_bytes = 0;
+    gc_ctx_t *ctx;
+    // only registered threads take part in stopping the world
+    (void)gc_thread_ctx();
+    if (!gc_stop_the_world())
+        return;
+    for(ctx = gc_ctxs; ctx != NULL; ctx = ctx->next) {
+        gc_st.allocd_total += ctx->allocd_bytes;
+        ctx->allocd_bytes = 0;
+    }
     if (is_gc_enabled) {
         JL_SIGATOMIC_BEGIN();
-#ifdef GCTIME
         double t0 = clock_now();
-#endif
+        gc_resolve_sample();
+        gc_finish_sweep();
+        gc_minor = (jl_gc_generational && !full && !gc_full_pending &&
+                    n_minor < minor_per_full);
+        if (gc_minor) {
+            n_minor++;
+            gc_st.nminor++;
+        }
+        else {
+            n_minor = 0;
+            gc_full_pending = 0;
+            rescan_objs.len = 0;
+        }
+        double t1 = clock_now();
         gc_mark();
+        double t2 = clock_now();
 #ifdef GCTIME
-        ios_printf(ios_stderr, "mark time %.3f ms\n", (clock_now()-t0)*1000);
+        ios_printf(ios_stderr, "mark time %.3f ms\n", (t2-t1)*1000);
 #endif
 #if defined(MEMPROFILE)
         all_pool_stats();
         big_obj_stats();
 #endif
-#ifdef GCTIME
-        t0 = clock_now();
-#endif
+        double t3 = clock_now();
         sweep_weak_refs();
         gc_sweep();
+        gc_update_interval();
+        double t4 = clock_now();
 #ifdef GCTIME
-        ios_printf(ios_stderr, "sweep time %.3f ms\n", (clock_now()-t0)*1000);
+        ios_printf(ios_stderr, "sweep time %.3f ms\n",
+                   ((t1-t0)+(t4-t3))*1000);
 #endif
+        // leftover lazy sweeping counts as sweep time; finalizers are not
+        // part of the pause
+        double pause = t4-t0;
+        gc_st.pauses[gc_st.ncollect % GC_NPAUSES] = pause;
+        gc_st.ncollect++;
+        gc_st.pause_total += pause;
+        if (pause > gc_st.pause_max)
+            gc_st.pause_max = pause;
+        gc_st.mark_total += t2-t1;
+        gc_st.sweep_total += (t1-t0)+(t4-t3);
+        remset.len = 0;
+        gc_minor = 0;
+        gc_resume_the_world();
         run_finalizers();
         JL_SIGATOMIC_END();
 #ifdef OBJPROFILE
@@ -706,68 +1909,100 @@ void jl_gc_collect(void)
         htable_reset(&obj_counts, 0);
 #endif
     }
+    else {
+        gc_resume_the_world();
+    }
+}
+
+void jl_gc_collect(void)
+{
+    gc_collect(1);
+}
+
+// a minor collection when generational mode is on, else a full one
+void jl_gc_collect_minor(void)
+{
+    gc_collect(0);
 }
 
 void *allocb(size_t sz)
 {
 #ifdef MEMDEBUG
-    return alloc_big(sz, 0);
+    return gc_sampled(alloc_big(sz, 0, 0), sz, 0);
 #endif
     if (sz > 2048-sizeof(void*))
-        return alloc_big(sz, 0);
+        return gc_sampled(alloc_big(sz, 0, 0), sz, 0);
+    gc_ctx_t *ctx = gc_thread_ctx();
     sz += sizeof(void*);
-    allocd_bytes += sz;
-    void *b = pool_alloc(&pools[szclass(sz)]);
-    return (void*)((void**)b + 1);
+    ctx->allocd_bytes += sz;
+    void *b = pool_alloc(ctx, &ctx->pools[szclass(sz)]);
+    return gc_sampled((void*)((void**)b + 1), sz, 0);
+}
+
+// a buffer cleared to zero. huge buffers come from the OS that way.
+void *allocb_zeroed(size_t sz)
+{
+#ifdef MEMDEBUG
+    return gc_sampled(alloc_big(sz, 0, 1), sz, 0);
+#endif
+    if (sz > 2048-sizeof(void*))
+        return gc_sampled(alloc_big(sz, 0, 1), sz, 0);
+    void *b = allocb(sz);
+    memset(b, 0, sz);
+    return b;
 }
 
 void *allocobj(size_t sz)
 {
 #ifdef MEMDEBUG
-    return alloc_big(sz, 1);
+    return gc_sampled(alloc_big(sz, 1, 0), sz, 1);
 #endif
     if (sz > 2048)
-        return alloc_big(sz, 1);
-    allocd_bytes += sz;
-    return pool_alloc(&pools[szclass(sz)]);
+        return gc_sampled(alloc_big(sz, 1, 0), sz, 1);
+    gc_ctx_t *ctx = gc_thread_ctx();
+    ctx->allocd_bytes += sz;
+    return gc_sampled(pool_alloc(ctx, &ctx->pools[szclass(sz)]), sz, 1);
 }
 
 void *alloc_2w(void)
 {
 #ifdef MEMDEBUG
-    return alloc_big(2*sizeof(void*), 1);
+    return gc_sampled(alloc_big(2*sizeof(void*), 1, 0), 2*sizeof(void*), 1);
 #endif
-    allocd_bytes += (2*sizeof(void*));
+    gc_ctx_t *ctx = gc_thread_ctx();
+    ctx->allocd_bytes += (2*sizeof(void*));
 #ifdef __LP64__
-    return pool_alloc(&pools[2]);
+    return gc_sampled(pool_alloc(ctx, &ctx->pools[2]), 2*sizeof(void*), 1);
 #else
-    return pool_alloc(&pools[0]);
+    return gc_sampled(pool_alloc(ctx, &ctx->pools[0]), 2*sizeof(void*), 1);
 #endif
 }
 
 void *alloc_3w(void)
 {
 #ifdef MEMDEBUG
-    return alloc_big(3*sizeof(void*), 1);
+    return gc_sampled(alloc_big(3*sizeof(void*), 1, 0), 3*sizeof(void*), 1);
 #endif
-    allocd_bytes += (3*sizeof(void*));
+    gc_ctx_t *ctx = gc_thread_ctx();
+    ctx->allocd_bytes += (3*sizeof(void*));
 #ifdef __LP64__
-    return pool_alloc(&pools[4]);
+    return gc_sampled(pool_alloc(ctx, &ctx->pools[4]), 3*sizeof(void*), 1);
 #else
-    return pool_alloc(&pools[1]);
+    return gc_sampled(pool_alloc(ctx, &ctx->pools[1]), 3*sizeof(void*), 1);
 #endif
 }
 
 void *alloc_4w(void)
 {
 #ifdef MEMDEBUG
-    return alloc_big(4*sizeof(void*), 1);
+    return gc_sampled(alloc_big(4*sizeof(void*), 1, 0), 4*sizeof(void*), 1);
 #endif
-    allocd_bytes += (4*sizeof(void*));
+    gc_ctx_t *ctx = gc_thread_ctx();
+    ctx->allocd_bytes += (4*sizeof(void*));
 #ifdef __LP64__
-    return pool_alloc(&pools[6]);
+    return gc_sampled(pool_alloc(ctx, &ctx->pools[6]), 4*sizeof(void*), 1);
 #else
-    return pool_alloc(&pools[2]);
+    return gc_sampled(pool_alloc(ctx, &ctx->pools[2]), 4*sizeof(void*), 1);
 #endif
 }
 
@@ -784,20 +2019,40 @@ void jl_gc_init(void)
 
                          1536, 2048 };
     int i;
-    for(i=0; i < N_POOLS; i++) {
-        norm_pools[i].osize = szc[i];
-        norm_pools[i].pages = NULL;
-        norm_pools[i].freelist = NULL;
-
-        ephe_pools[i].osize = szc[i];
-        ephe_pools[i].pages = NULL;
-        ephe_pools[i].freelist = NULL;
-    }
+    for(i=0; i < N_POOLS; i++)
+        pool_osize[i] = szc[i];
+    gc_ctx_init(&main_ctx);
+    main_ctx.next = NULL;
+    gc_ctx = &main_ctx;
 
     htable_new(&finalizer_table, 0);
     arraylist_new(&to_finalize, 0);
     arraylist_new(&preserved_values, 0);
     arraylist_new(&weak_refs, 0);
+    arraylist_new(&remset, 0);
+    arraylist_new(&rescan_objs, 0);
+
+    arraylist_new(&mark_stack, 0);
+    arraylist_new(&released_pages, 0);
+#ifndef OBJPROFILE
+    char *nthr = getenv("JULIA_GC_THREADS");
+    if (nthr != NULL && atoi(nthr) > 1)
+        gc_start_markers(atoi(nthr));
+#endif
+
+    char *gen = getenv("JULIA_GC_GENERATIONAL");
+    if (gen != NULL && atoi(gen) != 0)
+        jl_gc_set_generational(1);
+
+    char *mult = getenv("JULIA_GC_HEAP_MULT");
+    char *imin = getenv("JULIA_GC_MIN_INTERVAL");
+    char *imax = getenv("JULIA_GC_MAX_INTERVAL");
+    jl_gc_set_policy(mult ? strtod(mult, NULL) : 0,
+                     imin ? strtoul(imin, NULL, 10) : 0,
+                     imax ? strtoul(imax, NULL, 10) : 0);
+    char *limit = getenv("JULIA_GC_HEAP_LIMIT");
+    if (limit != NULL)
+        jl_gc_set_heap_limit(strtoul(limit, NULL, 10));
 
 #ifdef OBJPROFILE
     htable_new(&obj_counts, 0);
@@ -817,7 +2072,7 @@ static size_t pool_stats(pool_t *p, size_t *pwaste)
         char *lim = (char*)pg + GC_PAGE_SZ - osize;
         v = (gcval_t*)&pg->data[0];
         while ((char*)v <= lim) {
-            if (!v->marked) {
+            if (!page_marked(pg, v)) {
                 nfree++;
             }
             else {
@@ -844,16 +2099,19 @@ static void all_pool_stats(void)
 {
     int i;
     size_t nb=0, w, tw=0, no=0, b;
-    for(i=0; i < N_POOLS; i++) {
-        b = pool_stats(&norm_pools[i], &w);
-        nb += b;
-        no += (b/norm_pools[i].osize);
-        tw += w;
-
-        b = pool_stats(&ephe_pools[i], &w);
-        nb += b;
-        no += (b/ephe_pools[i].osize);
-        tw += w;
+    gc_ctx_t *ctx;
+    for(ctx = gc_ctxs; ctx != NULL; ctx = ctx->next) {
+        for(i=0; i < N_POOLS; i++) {
+            b = pool_stats(&ctx->norm_pools[i], &w);
+            nb += b;
+            no += (b/pool_osize[i]);
+            tw += w;
+
+            b = pool_stats(&ctx->ephe_pools[i], &w);
+            nb += b;
+            no += (b/pool_osize[i]);
+            tw += w;
+        }
     }
     ios_printf(ios_stdout,
                "%d objects, %d total allocated, %d total fragments\n",
@@ -862,18 +2120,38 @@ static void all_pool_stats(void)
 
 static void big_obj_stats(void)
 {
-    bigval_t *v = big_objects;
+    gc_ctx_t *ctx;
     size_t nused=0, nbytes=0;
-    while (v != NULL) {
-        if (v->isobj && (bigval_word0(v)&1)) {
-            nused++;
-            nbytes += v->sz;
+    for(ctx = gc_ctxs; ctx != NULL; ctx = ctx->next) {
+        int i;
+        for(i=0; i < N_BIG_BINS; i++) {
+            bigbin_t *b = &ctx->big_bins[i];
+            bigarena_t *a;
+            for(a = b->arenas; a != NULL; a = a->next) {
+                size_t j;
+                for(j=0; j < a->nblocks; j++) {
+                    bigval_t *v = arena_block(b, a, j);
+                    if (v->nbytes != 0 &&
+                        ((v->isobj && (bigval_word0(v)&1)) ||
+                         (!v->isobj && v->marked))) {
+                        nused++;
+                        nbytes += v->sz;
+                    }
+                }
+            }
         }
-        else if (!v->isobj && v->marked) {
-            nused++;
-            nbytes += v->sz;
+        bigval_t *v = ctx->big_objects;
+        while (v != NULL) {
+            if (v->isobj && (bigval_word0(v)&1)) {
+                nused++;
+                nbytes += v->sz;
+            }
+            else if (!v->isobj && v->marked) {
+                nused++;
+                nbytes += v->sz;
+            }
+            v = v->next;
         }
-        v = v->next;
     }
     ios_printf(ios_stdout, "%d bytes in %d large objects\n", nbytes, nused);
 }
@@ -20,10 +20,9 @@ static jl_methtable_t *new_method_table(void)
     mt->cache = NULL;
     mt->cache_arg1 = NULL;
     mt->cache_targ = NULL;
+    mt->cache_hash = NULL;
+    mt->invoke_cache = NULL;
     mt->max_args = jl_box_long(0);
-#ifdef JL_GF_PROFILE
-    mt->ncalls = 0;
-#endif
     return mt;
 }
 
@@ -138,11 +137,153 @@ static inline int cache_match(jl_value_t **args, size_t n, jl_tuple_t *sig,
   the first argument is a singleton kind (Type{Foo}), one indexed by the
   UID of the first argument's type in normal cases, and a fallback
   table of everything else.
+
+  Signatures made up entirely of concrete types are additionally entered
+  in an open-addressed hash table keyed on the UIDs of all the argument
+  types, so the common case is found without walking a list. Vararg,
+  Type{T} and tuple signatures are only kept in the lists.
 */
+
+#define CACHE_HASH_MINSZ 16
+#define cache_hash_max_probe(sz) ((sz)<=64 ? 8 : (sz)>>3)
+
+// uid of a type that can key the hash cache, or 0. values whose type is
+// a kind are types themselves and may have Type{T} entries, so they are
+// left to the lists.
+static inline uptrint_t cache_hash_uid(jl_value_t *t)
+{
+    if (jl_is_struct_type(t)) {
+        if (t == (jl_value_t*)jl_struct_kind || t == (jl_value_t*)jl_bits_kind ||
+            t == (jl_value_t*)jl_tag_kind || t == (jl_value_t*)jl_union_kind ||
+            t == (jl_value_t*)jl_func_kind || t == (jl_value_t*)jl_typector_type)
+            return 0;
+        return ((jl_struct_type_t*)t)->uid;
+    }
+    if (jl_is_bits_type(t))
+        return ((jl_bits_type_t*)t)->uid;
+    return 0;
+}
+
+#define cache_hash_mix(h, uid) inthash((h)*31 + (uid))
+
+// hash the argument types of a call, or of a type tuple if bytype is set.
+// returns 0 in *ok if some type cannot be hashed.
+static inline uptrint_t cache_hash_args(jl_value_t **args, size_t n,
+                                        int bytype, int *ok)
+{
+    uptrint_t h = n;
+    size_t i;
+    for(i=0; i < n; i++) {
+        jl_value_t *t = bytype ? args[i] : (jl_value_t*)jl_typeof(args[i]);
+        uptrint_t uid = cache_hash_uid(t);
+        if (uid == 0) {
+            *ok = 0;
+            return 0;
+        }
+        h = cache_hash_mix(h, uid);
+    }
+    *ok = 1;
+    return h;
+}
+
+static inline jl_function_t *cache_hash_lookup(jl_array_t *a,
+                                               jl_value_t **args, size_t n,
+                                               int bytype)
+{
+    int ok;
+    uptrint_t h = cache_hash_args(args, n, bytype, &ok);
+    if (!ok)
+        return NULL;
+    size_t sz = jl_array_len(a);
+    size_t maxprobe = cache_hash_max_probe(sz);
+    size_t i, p;
+    for(p=0; p < maxprobe; p++) {
+        jl_methlist_t *ml = (jl_methlist_t*)jl_cellref(a, (h+p) & (sz-1));
+        if (ml == NULL)
+            return NULL;
+        jl_tuple_t *sig = ml->sig;
+        if (sig->length == n) {
+            for(i=0; i < n; i++) {
+                jl_value_t *t = bytype ? args[i] : (jl_value_t*)jl_typeof(args[i]);
+                if (jl_tupleref(sig, i) != t)
+                    break;
+            }
+            if (i == n)
+                return ml->func;
+        }
+    }
+    return NULL;
+}
+
+// returns 0 if no slot was free within the probe limit
+static int cache_hash_put(jl_array_t *a, jl_methlist_t *ml, uptrint_t h)
+{
+    size_t sz = jl_array_len(a);
+    size_t maxprobe = cache_hash_max_probe(sz);
+    size_t p;
+    for(p=0; p < maxprobe; p++) {
+        jl_methlist_t **slot =
+            (jl_methlist_t**)&jl_cellref(a, (h+p) & (sz-1));
+        if (*slot == NULL || *slot == ml ||
+            jl_types_equal((jl_value_t*)(*slot)->sig, (jl_value_t*)ml->sig)) {
+            *slot = ml;
+            jl_gc_wb_back(a);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void cache_hash_insert(jl_methtable_t *mt, jl_methlist_t *ml)
+{
+    jl_tuple_t *sig = ml->sig;
+    if (ml->va == jl_true)
+        return;
+    int ok;
+    uptrint_t h = cache_hash_args(&jl_tupleref(sig,0), sig->length, 1, &ok);
+    if (!ok)
+        return;
+    if (mt->cache_hash == NULL)
+        mt->cache_hash = jl_alloc_cell_1d(CACHE_HASH_MINSZ);
+    if (cache_hash_put(mt->cache_hash, ml, h))
+        return;
+    // out of room near this slot; grow until every entry fits
+    jl_array_t *old = mt->cache_hash;
+    size_t oldsz = jl_array_len(old);
+    size_t newsz = oldsz;
+    jl_array_t *a = NULL;
+    JL_GC_PUSH(&a);
+    while (1) {
+        newsz *= 2;
+        a = jl_alloc_cell_1d(newsz);
+        size_t i;
+        for(i=0; i < oldsz; i++) {
+            jl_methlist_t *e = (jl_methlist_t*)jl_cellref(old, i);
+            if (e == NULL)
+                continue;
+            uptrint_t eh = cache_hash_args(&jl_tupleref(e->sig,0),
+                                           e->sig->length, 1, &ok);
+            if (!cache_hash_put(a, e, eh))
+                break;
+        }
+        if (i == oldsz && cache_hash_put(a, ml, h))
+            break;
+    }
+    mt->cache_hash = a;
+    JL_GC_POP();
+}
+
 static jl_function_t *jl_method_table_assoc_exact_by_type(jl_methtable_t *mt,
                                                           jl_tuple_t *types)
 {
     jl_methlist_t *ml = NULL;
+    if (mt->cache_hash) {
+        jl_function_t *f = cache_hash_lookup(mt->cache_hash,
+                                             &jl_tupleref(types,0),
+                                             types->length, 1);
+        if (f)
+            return f;
+    }
     if (types->length > 0) {
         jl_value_t *ty = jl_t0(types);
         uptrint_t uid;
@@ -183,6 +324,11 @@ static jl_function_t *jl_method_table_assoc_exact(jl_methtable_t *mt,
                                                   jl_value_t **args, size_t n)
 {
     jl_methlist_t *ml = NULL;
+    if (mt->cache_hash) {
+        jl_function_t *f = cache_hash_lookup(mt->cache_hash, args, n, 0);
+        if (f)
+            return f;
+    }
     if (n > 0) {
         jl_value_t *a0 = args[0];
         jl_value_t *ty = (jl_value_t*)jl_typeof(a0);
@@ -247,6 +393,7 @@ jl_lambda_info_t *jl_add_static_parameters(jl_lambda_info_t *l, jl_tuple_t *sp)
     nli->module = l->module;
     nli->file = l->file;
     nli->line = l->line;
+    nli->optlevel = l->optlevel;
     JL_GC_POP();
     return nli;
 }
@@ -280,6 +427,8 @@ jl_function_t *jl_method_cache_insert(jl_methtable_t *mt, jl_tuple_t *type,
                                       jl_function_t *method)
 {
     jl_methlist_t **pml = &mt->cache;
+    jl_array_t *cache = NULL;
+    jl_methlist_t *ml;
     if (type->length > 0) {
         jl_value_t *t0 = jl_t0(type);
         uptrint_t uid=0;
@@ -298,7 +447,8 @@ jl_function_t *jl_method_cache_insert(jl_methtable_t *mt, jl_tuple_t *type,
                 if (uid >= jl_array_len(mt->cache_targ)) {
                     jl_array_grow_end(mt->cache_targ, uid+4-jl_array_len(mt->cache_targ));
                 }
-                pml = (jl_methlist_t**)&jl_cellref(mt->cache_targ, uid);
+                cache = mt->cache_targ;
+                pml = (jl_methlist_t**)&jl_cellref(cache, uid);
                 goto ml_do_insert;
             }
         }
@@ -312,11 +462,16 @@ jl_function_t *jl_method_cache_insert(jl_methtable_t *mt, jl_tuple_t *type,
             if (uid >= jl_array_len(mt->cache_arg1)) {
                 jl_array_grow_end(mt->cache_arg1, uid+4-jl_array_len(mt->cache_arg1));
             }
-            pml = (jl_methlist_t**)&jl_cellref(mt->cache_arg1, uid);
+            cache = mt->cache_arg1;
+            pml = (jl_methlist_t**)&jl_cellref(cache, uid);
         }
     }
  ml_do_insert:
-    return jl_method_list_insert(pml, type, method, jl_null, 0)->func;
+    ml = jl_method_list_insert(pml, type, method, jl_null, 0);
+    if (cache != NULL)
+        jl_gc_wb_back(cache);
+    cache_hash_insert(mt, ml);
+    return ml->func;
 }
 
 extern jl_function_t *jl_typeinf_func;
@@ -415,6 +570,151 @@ static int tuple_all_Any(jl_tuple_t *t)
     return 1;
 }
 
+// --- dispatch profiler ---
+
+// per generic function counts, kept while jl_gf_profile_on is set
+typedef struct {
+    jl_methtable_t *mt;
+    jl_sym_t *name;
+    size_t ncalls;    // calls dispatched through jl_apply_generic
+    size_t nhits;     // calls found in the method cache
+    size_t nmisses;   // calls that went to jl_mt_assoc_by_type
+    size_t nspecs;    // specializations added by cache_method
+    size_t nwidened;  // signatures widened by the specialization limit
+    double inftime;   // seconds in type inference, including callees
+} gf_profile_t;
+
+int jl_gf_profile_on = 0;
+static htable_t gf_profile_index;   // methtable -> entry index+1
+static gf_profile_t *gf_profile = NULL;
+static size_t gf_profile_n = 0;
+static size_t gf_profile_max = 0;
+
+static gf_profile_t *gf_profile_entry(jl_methtable_t *mt, jl_sym_t *name)
+{
+    if (gf_profile_index.table == NULL)
+        htable_new(&gf_profile_index, 0);
+    void **bp = ptrhash_bp(&gf_profile_index, mt);
+    if (*bp != HT_NOTFOUND)
+        return &gf_profile[(size_t)*bp - 1];
+    if (gf_profile_n == gf_profile_max) {
+        size_t newmax = gf_profile_max ? gf_profile_max*2 : 64;
+        gf_profile_t *np = (gf_profile_t*)realloc(gf_profile,
+                                                  newmax*sizeof(gf_profile_t));
+        if (np == NULL)
+            jl_raise(jl_memory_exception);
+        gf_profile = np;
+        gf_profile_max = newmax;
+    }
+    gf_profile_t *e = &gf_profile[gf_profile_n++];
+    memset(e, 0, sizeof(gf_profile_t));
+    e->mt = mt;
+    e->name = name;
+    *bp = (void*)gf_profile_n;
+    return e;
+}
+
+// the methtables in the profile are kept alive until it is cleared
+void jl_mark_gf_profile(void)
+{
+    size_t i;
+    for(i=0; i < gf_profile_n; i++)
+        jl_gc_markval((jl_value_t*)gf_profile[i].mt);
+}
+
+DLLEXPORT void jl_gf_profile(int on)
+{
+    jl_gf_profile_on = on;
+    // inline caches bypass jl_apply_generic, so invalidate them all; they
+    // are not refilled while profiling.
+    jl_world_counter++;
+}
+
+DLLEXPORT void jl_gf_profile_clear(void)
+{
+    if (gf_profile_index.table != NULL)
+        htable_reset(&gf_profile_index, 0);
+    gf_profile_n = 0;
+}
+
+// (name, calls, cache hits, slow lookups, specializations, inference
+// seconds, widened signatures) for each generic function seen
+DLLEXPORT jl_value_t *jl_gf_profile_data(void)
+{
+    jl_array_t *a = NULL;
+    jl_tuple_t *t = NULL;
+    size_t i;
+    JL_GC_PUSH(&a, &t);
+    a = jl_alloc_cell_1d(gf_profile_n);
+    for(i=0; i < gf_profile_n; i++) {
+        gf_profile_t *e = &gf_profile[i];
+        t = jl_alloc_tuple(7);
+        jl_tupleset(t, 0, e->name ? (jl_value_t*)e->name : jl_nothing);
+        jl_tupleset(t, 1, jl_box_long(e->ncalls));
+        jl_tupleset(t, 2, jl_box_long(e->nhits));
+        jl_tupleset(t, 3, jl_box_long(e->nmisses));
+        jl_tupleset(t, 4, jl_box_long(e->nspecs));
+        jl_tupleset(t, 5, jl_box_float64(e->inftime));
+        jl_tupleset(t, 6, jl_box_long(e->nwidened));
+        jl_arrayset(a, i, (jl_value_t*)t);
+    }
+    JL_GC_POP();
+    return (jl_value_t*)a;
+}
+
+static void gf_profile_spec(jl_methtable_t *mt, jl_function_t *method)
+{
+    if (jl_gf_profile_on) {
+        jl_sym_t *name = method->linfo ? method->linfo->name : NULL;
+        gf_profile_entry(mt, name)->nspecs++;
+    }
+}
+
+// --- specialization budget ---
+
+// once a definition has this many specializations, new signatures are
+// widened where the declaration allows it, so they share code. 0 means
+// no limit.
+static size_t spec_limit = 0;
+static size_t n_specializations = 0;
+static size_t n_widened = 0;
+
+DLLEXPORT void jl_set_specialization_limit(size_t n)
+{
+    spec_limit = n;
+}
+
+// specializations created, signatures widened, current limit
+DLLEXPORT void jl_specialization_stats(size_t *counts)
+{
+    counts[0] = n_specializations;
+    counts[1] = n_widened;
+    counts[2] = spec_limit;
+}
+
+void jl_init_specialization_limit(void)
+{
+    char *lim = getenv("JULIA_SPECIALIZATION_LIMIT");
+    if (lim)
+        jl_set_specialization_limit(strtoul(lim, NULL, 10));
+}
+
+// whether no definition ahead of method intersects type, in which case
+// type can be cached as a signature of method.
+static int only_match(jl_methtable_t *mt, jl_tuple_t *type,
+                      jl_function_t *method)
+{
+    jl_methlist_t *curr = mt->defs;
+    while (curr != NULL && curr->func!=method) {
+        if (jl_type_intersection((jl_value_t*)curr->sig,
+                                 (jl_value_t*)type) !=
+            (jl_value_t*)jl_bottom_type)
+            return 0;
+        curr = curr->next;
+    }
+    return 1;
+}
+
 static jl_function_t *cache_method(jl_methtable_t *mt, jl_tuple_t *type,
                                    jl_function_t *method, jl_tuple_t *decl,
                                    jl_tuple_t *sparams)
@@ -432,20 +732,9 @@ static jl_function_t *cache_method(jl_methtable_t *mt, jl_tuple_t *type,
             // don't specialize on slots marked ANY
             temp = jl_tupleref(type, i);
             jl_tupleset(type, i, (jl_value_t*)jl_any_type);
-            int nintr=0;
-            jl_methlist_t *curr = mt->defs;
             // if this method is the only match even with the current slot
             // set to Any, then it is safe to cache it that way.
-            while (curr != NULL && curr->func!=method) {
-                if (jl_type_intersection((jl_value_t*)curr->sig,
-                                         (jl_value_t*)type) !=
-                    (jl_value_t*)jl_bottom_type) {
-                    nintr++;
-                    break;
-                }
-                curr = curr->next;
-            }
-            if (nintr) {
+            if (!only_match(mt, type, method)) {
                 // TODO: even if different specializations of this slot need
                 // separate cache entries, have them share code.
                 jl_tupleset(type, i, temp);
@@ -570,6 +859,33 @@ static jl_function_t *cache_method(jl_methtable_t *mt, jl_tuple_t *type,
         }
     }
 
+    if (spec_limit > 0 && method->linfo != NULL &&
+        method->linfo->specializations != NULL &&
+        jl_array_len(method->linfo->specializations) >= spec_limit) {
+        // over budget: cache slots declared Any as Any. slots declared
+        // with a type variable are left alone, since the static
+        // parameters were matched against the actual argument.
+        int widened = 0;
+        for (i=0; i < type->length; i++) {
+            temp = jl_tupleref(type, i);
+            if (nth_slot_type(decl,i) != (jl_value_t*)jl_any_type ||
+                temp == (jl_value_t*)jl_any_type || jl_is_tuple(temp))
+                continue;
+            jl_tupleset(type, i, (jl_value_t*)jl_any_type);
+            if (only_match(mt, type, method))
+                widened = 1;
+            else
+                jl_tupleset(type, i, temp);
+        }
+        if (widened) {
+            n_widened++;
+            if (jl_gf_profile_on) {
+                jl_sym_t *name = method->linfo->name;
+                gf_profile_entry(mt, name)->nwidened++;
+            }
+        }
+    }
+
     // for varargs methods, only specialize up to max_args.
     // in general, here we want to find the biggest type that's not a
     // supertype of any other method signatures. so far we are conservative
@@ -663,6 +979,7 @@ static jl_function_t *cache_method(jl_methtable_t *mt, jl_tuple_t *type,
         assert(li);
         newmeth = jl_reinstantiate_method(method, li);
         (void)jl_method_cache_insert(mt, type, newmeth);
+        gf_profile_spec(mt, method);
         JL_GC_POP();
         return newmeth;
     }
@@ -685,6 +1002,7 @@ static jl_function_t *cache_method(jl_methtable_t *mt, jl_tuple_t *type,
     */
 
     (void)jl_method_cache_insert(mt, type, newmeth);
+    gf_profile_spec(mt, method);
 
     if (newmeth->linfo != NULL && newmeth->linfo->sparams == jl_null) {
         // when there are no static parameters, one unspecialized version
@@ -707,7 +1025,16 @@ static jl_function_t *cache_method(jl_methtable_t *mt, jl_tuple_t *type,
             jl_cell_1d_push(spe, (jl_value_t*)newmeth->linfo);
         }
         method->linfo->specializations = spe;
-        jl_type_infer(newmeth->linfo, type, method->linfo);
+        n_specializations++;
+        if (jl_gf_profile_on) {
+            double t0 = clock_now();
+            jl_type_infer(newmeth->linfo, type, method->linfo);
+            gf_profile_entry(mt, method->linfo->name)->inftime +=
+                clock_now() - t0;
+        }
+        else {
+            jl_type_infer(newmeth->linfo, type, method->linfo);
+        }
     }
     JL_GC_POP();
     return newmeth;
@@ -781,6 +1108,42 @@ static int sigs_eq(jl_value_t *a, jl_value_t *b)
     return jl_types_equal(a, b);
 }
 
+// the lambda of the method of f defined with exactly the signature sig, or
+// f's own lambda if it is not a generic function
+static jl_lambda_info_t *method_linfo(jl_function_t *f, jl_tuple_t *sig)
+{
+    if (!jl_is_gf(f))
+        return f->linfo;
+    jl_methlist_t *ml = jl_gf_mtable(f)->defs;
+    while (ml != NULL) {
+        if (sigs_eq((jl_value_t*)ml->sig, (jl_value_t*)sig))
+            return ml->func->linfo;
+        ml = ml->next;
+    }
+    return NULL;
+}
+
+// force the LLVM optimization level used for the method of f with signature
+// sig. specializations compiled later inherit it; -1 restores the default.
+DLLEXPORT void jl_set_function_opt_level(jl_function_t *f, jl_tuple_t *sig,
+                                         int level)
+{
+    jl_lambda_info_t *li = method_linfo(f, sig);
+    if (li == NULL)
+        jl_error("optimization_level: no method with that signature");
+    if (level < 0) level = -1;
+    if (level > JL_MAX_OPT_LEVEL) level = JL_MAX_OPT_LEVEL;
+    li->optlevel = level;
+}
+
+DLLEXPORT int jl_get_function_opt_level(jl_function_t *f, jl_tuple_t *sig)
+{
+    jl_lambda_info_t *li = method_linfo(f, sig);
+    if (li == NULL)
+        jl_error("optimization_level: no method with that signature");
+    return li->optlevel;
+}
+
 int jl_args_morespecific(jl_value_t *a, jl_value_t *b)
 {
     int msp = jl_type_morespecific(a,b,0);
@@ -816,6 +1179,52 @@ static int is_va_tuple(jl_tuple_t *t)
     return (t->length>0 && jl_is_seq_type(jl_tupleref(t,t->length-1)));
 }
 
+// cheap test for two argument types that can have no values in common:
+// nominal types are disjoint unless one names the other as a supertype.
+// returns 0 when unsure.
+static int tag_types_disjoint(jl_value_t *a, jl_value_t *b)
+{
+    if (a == b || !jl_is_some_tag_type(a) || !jl_is_some_tag_type(b))
+        return 0;
+    jl_tag_type_t *ta = (jl_tag_type_t*)a, *tb = (jl_tag_type_t*)b;
+    // Type{T} contains kinds, and Undef is special-cased by subtyping
+    if (ta->name == jl_type_type->name || tb->name == jl_type_type->name ||
+        ta == jl_undef_type || tb == jl_undef_type ||
+        jl_is_seq_type(a) || jl_is_seq_type(b))
+        return 0;
+    jl_tag_type_t *t = ta;
+    while (1) {
+        if (t->name == tb->name) return 0;
+        if (t == jl_any_type) break;
+        t = t->super;
+    }
+    t = tb;
+    while (1) {
+        if (t->name == ta->name) return 0;
+        if (t == jl_any_type) break;
+        t = t->super;
+    }
+    return 1;
+}
+
+// signatures that provably do not overlap, found without allocating.
+// used to skip the full intersection for unrelated definitions.
+static int sigs_disjoint(jl_tuple_t *a, jl_tuple_t *b)
+{
+    int ava = is_va_tuple(a), bva = is_va_tuple(b);
+    if (!ava && !bva && a->length != b->length)
+        return 1;
+    size_t i, n = a->length < b->length ? a->length : b->length;
+    for(i=0; i < n; i++) {
+        jl_value_t *ea = jl_tupleref(a,i), *eb = jl_tupleref(b,i);
+        if (jl_is_seq_type(ea) || jl_is_seq_type(eb))
+            break;
+        if (tag_types_disjoint(ea, eb))
+            return 1;
+    }
+    return 0;
+}
+
 /*
   warn about ambiguous method priorities
   
@@ -838,6 +1247,8 @@ static void check_ambiguous(jl_methlist_t *ml, jl_tuple_t *type,
                             jl_tuple_t *sig, jl_sym_t *fname)
 {
     // we know !jl_args_morespecific(type, sig)
+    if (sigs_disjoint(type, sig))
+        return;
     if ((type->length==sig->length ||
          (type->length==sig->length+1 && is_va_tuple(type)) ||
          (type->length+1==sig->length && is_va_tuple(sig))) &&
@@ -898,7 +1309,8 @@ jl_methlist_t *jl_method_list_insert(jl_methlist_t **pml, jl_tuple_t *type,
     assert(jl_is_tuple(type));
     l = *pml;
     while (l != NULL) {
-        if (sigs_eq((jl_value_t*)type, (jl_value_t*)l->sig)) {
+        if (!sigs_disjoint(type, l->sig) &&
+            sigs_eq((jl_value_t*)type, (jl_value_t*)l->sig)) {
             // method overwritten
             JL_SIGATOMIC_BEGIN();
             l->sig = type;
@@ -969,12 +1381,18 @@ jl_methlist_t *jl_method_list_insert(jl_methlist_t **pml, jl_tuple_t *type,
     return newrec;
 }
 
-static void remove_conflicting(jl_methlist_t **pl, jl_value_t *type)
+static int sig_conflicts(jl_tuple_t *type, jl_tuple_t *sig)
+{
+    return !sigs_disjoint(type, sig) &&
+        jl_type_intersection((jl_value_t*)type, (jl_value_t*)sig) !=
+        (jl_value_t*)jl_bottom_type;
+}
+
+static void remove_conflicting(jl_methlist_t **pl, jl_tuple_t *type)
 {
     jl_methlist_t *l = *pl;
     while (l != NULL) {
-        if (jl_type_intersection(type, (jl_value_t*)l->sig) !=
-            (jl_value_t*)jl_bottom_type) {
+        if (sig_conflicts(type, l->sig)) {
             *pl = l->next;
         }
         else {
@@ -984,6 +1402,57 @@ static void remove_conflicting(jl_methlist_t **pl, jl_value_t *type)
     }
 }
 
+// every entry in a cache_arg1 or cache_targ bucket has the same first
+// argument type, so whole buckets can be skipped by looking at one entry.
+static void remove_conflicting_buckets(jl_array_t *cache, jl_tuple_t *type)
+{
+    jl_value_t *t0 = type->length > 0 ? jl_tupleref(type,0) : NULL;
+    size_t i;
+    for(i=0; i < jl_array_len(cache); i++) {
+        jl_methlist_t **pl = (jl_methlist_t**)&jl_cellref(cache,i);
+        if (*pl == NULL)
+            continue;
+        if (t0 != NULL && (*pl)->sig->length > 0 &&
+            tag_types_disjoint(t0, jl_tupleref((*pl)->sig,0)))
+            continue;
+        remove_conflicting(pl, type);
+    }
+}
+
+// drop hash cache entries that overlap a new definition, rehashing the
+// survivors into a fresh table.
+static void cache_hash_remove_conflicting(jl_methtable_t *mt, jl_tuple_t *type)
+{
+    jl_array_t *old = mt->cache_hash;
+    if (old == NULL)
+        return;
+    size_t i, sz = jl_array_len(old);
+    for(i=0; i < sz; i++) {
+        jl_methlist_t *e = (jl_methlist_t*)jl_cellref(old, i);
+        if (e != NULL && sig_conflicts(type, e->sig))
+            break;
+    }
+    if (i == sz)
+        return;
+    jl_array_t *a = jl_alloc_cell_1d(sz);
+    JL_GC_PUSH(&a);
+    for(i=0; i < sz; i++) {
+        jl_methlist_t *e = (jl_methlist_t*)jl_cellref(old, i);
+        if (e == NULL || sig_conflicts(type, e->sig))
+            continue;
+        int ok;
+        uptrint_t h = cache_hash_args(&jl_tupleref(e->sig,0),
+                                      e->sig->length, 1, &ok);
+        if (!cache_hash_put(a, e, h)) {
+            // rare; the lists still hold everything
+            a = NULL;
+            break;
+        }
+    }
+    mt->cache_hash = a;
+    JL_GC_POP();
+}
+
 jl_methlist_t *jl_method_table_insert(jl_methtable_t *mt, jl_tuple_t *type,
                                       jl_function_t *method, jl_tuple_t *tvars)
 {
@@ -992,21 +1461,14 @@ jl_methlist_t *jl_method_table_insert(jl_methtable_t *mt, jl_tuple_t *type,
     JL_SIGATOMIC_BEGIN();
     jl_methlist_t *ml = jl_method_list_insert(&mt->defs,type,method,tvars,1);
     // invalidate cached methods that overlap this definition
-    remove_conflicting(&mt->cache, (jl_value_t*)type);
-    if (mt->cache_arg1) {
-        for(int i=0; i < jl_array_len(mt->cache_arg1); i++) {
-            jl_methlist_t **pl = (jl_methlist_t**)&jl_cellref(mt->cache_arg1,i);
-            if (*pl)
-                remove_conflicting(pl, (jl_value_t*)type);
-        }
-    }
-    if (mt->cache_targ) {
-        for(int i=0; i < jl_array_len(mt->cache_targ); i++) {
-            jl_methlist_t **pl = (jl_methlist_t**)&jl_cellref(mt->cache_targ,i);
-            if (*pl)
-                remove_conflicting(pl, (jl_value_t*)type);
-        }
-    }
+    jl_world_counter++;
+    mt->invoke_cache = NULL;
+    cache_hash_remove_conflicting(mt, type);
+    remove_conflicting(&mt->cache, type);
+    if (mt->cache_arg1)
+        remove_conflicting_buckets(mt->cache_arg1, type);
+    if (mt->cache_targ)
+        remove_conflicting_buckets(mt->cache_targ, type);
     // update max_args
     jl_tuple_t *t = (jl_tuple_t*)type;
     size_t na = t->length;
@@ -1115,13 +1577,18 @@ static int trace_en = 0;
 static void enable_trace(int x) { trace_en=x; }
 #endif
 
-JL_CALLABLE(jl_apply_generic)
+// if pcache is given, it is cleared when the result is only a stand-in
+// and should not be remembered by the caller.
+static jl_function_t *jl_gf_dispatch(jl_value_t *F, jl_value_t **args,
+                                     uint32_t nargs, int *pcache)
 {
     jl_value_t *env = ((jl_function_t*)F)->env;
     jl_methtable_t *mt = (jl_methtable_t*)jl_t0(env);
-#ifdef JL_GF_PROFILE
-    mt->ncalls++;
-#endif
+    gf_profile_t *prof = NULL;
+    if (jl_gf_profile_on) {
+        prof = gf_profile_entry(mt, (jl_sym_t*)jl_t1(env));
+        prof->ncalls++;
+    }
 #ifdef JL_TRACE
     if (trace_en) {
         ios_printf(ios_stdout, "%s(", ((jl_sym_t*)jl_t1(env))->name);
@@ -1144,6 +1611,8 @@ JL_CALLABLE(jl_apply_generic)
     */
     jl_function_t *mfunc = jl_method_table_assoc_exact(mt, args, nargs);
     if (mfunc != NULL) {
+        if (prof)
+            prof->nhits++;
         if (mfunc->linfo != NULL && 
             (mfunc->linfo->inInference || mfunc->linfo->inCompile)) {
             // if inference is running on this function, return a copy
@@ -1153,20 +1622,103 @@ JL_CALLABLE(jl_apply_generic)
                 li->unspecialized = jl_instantiate_method(mfunc, li->sparams);
             }
             mfunc = li->unspecialized;
+            if (pcache)
+                *pcache = 0;
         }
     }
     else {
+        if (prof)
+            prof->nmisses++;
         jl_tuple_t *tt = arg_type_tuple(args, nargs);
         JL_GC_PUSH(&tt);
         mfunc = jl_mt_assoc_by_type(mt, tt, 1);
         JL_GC_POP();
     }
+    assert(!mfunc || !mfunc->linfo || !mfunc->linfo->inInference);
+    return mfunc;
+}
 
+JL_CALLABLE(jl_apply_generic)
+{
+    jl_function_t *mfunc = jl_gf_dispatch(F, args, nargs, NULL);
     if (mfunc == NULL) {
         return jl_no_method_error((jl_function_t*)F, args, nargs);
     }
-    assert(!mfunc->linfo || !mfunc->linfo->inInference);
+    return jl_apply(mfunc, args, nargs);
+}
+
+// --- call site inline caches ---
 
+// starts at 1 so that empty entries never match
+size_t jl_world_counter = 1;
+
+jl_callsite_t *jl_new_callsite(size_t nargs)
+{
+    size_t sz = sizeof(jl_callsite_t) +
+        (JL_IC_NENTRIES*(nargs+2)-1)*sizeof(void*);
+    jl_callsite_t *site = (jl_callsite_t*)malloc(sz);
+    if (site == NULL)
+        jl_raise(jl_memory_exception);
+    memset(site, 0, sz);
+    site->nargs = nargs;
+    return site;
+}
+
+static int ic_entry_match(void **e, jl_value_t **args, size_t nargs)
+{
+    if ((size_t)e[0] != jl_world_counter)
+        return 0;
+    size_t i;
+    for(i=0; i < nargs; i++) {
+        if (e[2+i] != (void*)jl_typeof(args[i]))
+            return 0;
+    }
+    return 1;
+}
+
+// slow path of an inline-cached call. generated code only checks the
+// first entry; the others are checked here, and whatever is found is
+// moved to the front so a site that settles on one signature stays on
+// the inline path.
+jl_value_t *jl_apply_generic_ic(jl_value_t *F, jl_value_t **args,
+                                uint32_t nargs, jl_callsite_t *site)
+{
+    size_t esz = (nargs+2)*sizeof(void*);
+    void *tmp[nargs+2];
+    jl_function_t *mfunc;
+    int k;
+    assert(site->nargs == nargs);
+    for(k=1; k < JL_IC_NENTRIES; k++) {
+        void **e = jl_ic_entry(site, k);
+        if (ic_entry_match(e, args, nargs)) {
+            mfunc = (jl_function_t*)e[1];
+            memcpy(tmp, e, esz);
+            memmove(jl_ic_entry(site,1), jl_ic_entry(site,0), k*esz);
+            memcpy(jl_ic_entry(site,0), tmp, esz);
+            return jl_apply(mfunc, args, nargs);
+        }
+    }
+    int ok = !jl_gf_profile_on;
+    mfunc = jl_gf_dispatch(F, args, nargs, &ok);
+    if (mfunc == NULL) {
+        return jl_no_method_error((jl_function_t*)F, args, nargs);
+    }
+    // only results that depend on nothing but the concrete argument
+    // types can be cached; this is what the hashed method cache accepts.
+    size_t i;
+    for(i=0; ok && i < nargs; i++) {
+        if (cache_hash_uid((jl_value_t*)jl_typeof(args[i])) == 0)
+            ok = 0;
+    }
+    if (ok) {
+        memmove(jl_ic_entry(site,1), jl_ic_entry(site,0),
+                (JL_IC_NENTRIES-1)*esz);
+        void **e = jl_ic_entry(site, 0);
+        e[0] = (void*)jl_world_counter;
+        e[1] = (void*)mfunc;
+        for(i=0; i < nargs; i++)
+            e[2+i] = (void*)jl_typeof(args[i]);
+    }
     return jl_apply(mfunc, args, nargs);
 }
 
@@ -1179,17 +1731,147 @@ JL_CALLABLE(jl_apply_generic)
 // every definition has its own private method table for this purpose.
 //
 // NOTE: assumes argument type is a subtype of the lookup type.
-jl_value_t *jl_gf_invoke(jl_function_t *gf, jl_tuple_t *types,
-                         jl_value_t **args, size_t nargs)
+/*
+  invoke() signatures are looked up in mt->invoke_cache, an open-addressed
+  table of (types, def, env) triples keyed on the argument types of the
+  signature, before falling back to a walk over mt->defs. abstract types
+  are keyed by the hash of their name, so the common invoke(f, (Number,), x)
+  is found without calling the subtype machinery. the table is dropped
+  whenever a definition is added to the method table.
+*/
+
+#define INVOKE_CACHE_MINSZ 8
+
+static uptrint_t invoke_cache_hash(jl_tuple_t *types, int *ok)
 {
-    assert(jl_is_gf(gf));
-    jl_methtable_t *mt = jl_gf_mtable(gf);
+    uptrint_t h = types->length;
+    size_t i;
+    for(i=0; i < types->length; i++) {
+        jl_value_t *t = jl_tupleref(types,i);
+        uptrint_t k = cache_hash_uid(t);
+        if (k == 0) {
+            if (!jl_is_some_tag_type(t)) {
+                *ok = 0;
+                return 0;
+            }
+            k = ((jl_tag_type_t*)t)->name->name->hash;
+        }
+        h = cache_hash_mix(h, k);
+    }
+    *ok = 1;
+    return h;
+}
 
-    jl_methlist_t *m = mt->defs;
-    size_t typelen = types->length;
+static int invoke_types_eq(jl_tuple_t *a, jl_tuple_t *b)
+{
+    if (a == b)
+        return 1;
+    if (a->length != b->length)
+        return 0;
     size_t i;
-    jl_value_t *env = (jl_value_t*)jl_false;
+    for(i=0; i < a->length; i++) {
+        if (jl_tupleref(a,i) != jl_tupleref(b,i))
+            return 0;
+    }
+    return 1;
+}
+
+static jl_methlist_t *invoke_cache_lookup(jl_array_t *a, jl_tuple_t *types,
+                                          jl_value_t **penv)
+{
+    int ok;
+    uptrint_t h = invoke_cache_hash(types, &ok);
+    if (!ok)
+        return NULL;
+    size_t sz = jl_array_len(a)/3;
+    size_t maxprobe = cache_hash_max_probe(sz);
+    size_t p;
+    for(p=0; p < maxprobe; p++) {
+        size_t i = ((h+p) & (sz-1))*3;
+        jl_tuple_t *k = (jl_tuple_t*)jl_cellref(a, i);
+        if (k == NULL)
+            return NULL;
+        if (invoke_types_eq(k, types)) {
+            *penv = jl_cellref(a, i+2);
+            return (jl_methlist_t*)jl_cellref(a, i+1);
+        }
+    }
+    return NULL;
+}
+
+// returns 0 if no slot was free within the probe limit
+static int invoke_cache_put(jl_array_t *a, jl_tuple_t *types,
+                            jl_methlist_t *m, jl_value_t *env, uptrint_t h)
+{
+    size_t sz = jl_array_len(a)/3;
+    size_t maxprobe = cache_hash_max_probe(sz);
+    size_t p;
+    for(p=0; p < maxprobe; p++) {
+        size_t i = ((h+p) & (sz-1))*3;
+        jl_tuple_t *k = (jl_tuple_t*)jl_cellref(a, i);
+        if (k == NULL || invoke_types_eq(k, types)) {
+            jl_cellset(a, i, (jl_value_t*)types);
+            jl_cellset(a, i+1, (jl_value_t*)m);
+            jl_cellset(a, i+2, env);
+            jl_gc_wb_back(a);
+            return 1;
+        }
+    }
+    return 0;
+}
 
+static void invoke_cache_insert(jl_methtable_t *mt, jl_tuple_t *types,
+                                jl_methlist_t *m, jl_value_t *env)
+{
+    int ok;
+    uptrint_t h = invoke_cache_hash(types, &ok);
+    if (!ok)
+        return;
+    if (mt->invoke_cache == NULL)
+        mt->invoke_cache = jl_alloc_cell_1d(INVOKE_CACHE_MINSZ*3);
+    if (invoke_cache_put(mt->invoke_cache, types, m, env, h))
+        return;
+    jl_array_t *old = mt->invoke_cache;
+    size_t oldn = jl_array_len(old);
+    size_t newn = oldn;
+    jl_array_t *a = NULL;
+    JL_GC_PUSH(&a);
+    while (1) {
+        newn *= 2;
+        a = jl_alloc_cell_1d(newn);
+        size_t i;
+        for(i=0; i < oldn; i+=3) {
+            jl_tuple_t *k = (jl_tuple_t*)jl_cellref(old, i);
+            if (k == NULL)
+                continue;
+            if (!invoke_cache_put(a, k, (jl_methlist_t*)jl_cellref(old, i+1),
+                                  jl_cellref(old, i+2),
+                                  invoke_cache_hash(k, &ok)))
+                break;
+        }
+        if (i == oldn && invoke_cache_put(a, types, m, env, h))
+            break;
+    }
+    mt->invoke_cache = a;
+    JL_GC_POP();
+}
+
+// find the definition invoke() calls for a signature, and the static
+// parameter environment it matched with (jl_false if it has none).
+static jl_methlist_t *invoke_lookup(jl_methtable_t *mt, jl_tuple_t *types,
+                                    jl_value_t **penv)
+{
+    jl_methlist_t *m;
+    *penv = (jl_value_t*)jl_false;
+    if (mt->invoke_cache != NULL) {
+        m = invoke_cache_lookup(mt->invoke_cache, types, penv);
+        if (m != NULL)
+            return m;
+    }
+
+    m = mt->defs;
+    size_t typelen = types->length;
+    jl_value_t *env = (jl_value_t*)jl_false;
     while (m != NULL) {
         if (m->tvars!=jl_null) {
             env = jl_type_match((jl_value_t*)types, (jl_value_t*)m->sig);
@@ -1202,6 +1884,60 @@ jl_value_t *jl_gf_invoke(jl_function_t *gf, jl_tuple_t *types,
         }
         m = m->next;
     }
+    if (m != NULL) {
+        JL_GC_PUSH(&env);
+        invoke_cache_insert(mt, types, m, env);
+        JL_GC_POP();
+    }
+    *penv = env;
+    return m;
+}
+
+// make a specialization of definition m for argument types tt, to be
+// called through invoke().
+static jl_function_t *invoke_specialize(jl_methlist_t *m, jl_value_t *env,
+                                        jl_tuple_t *tt)
+{
+    jl_tuple_t *tpenv=jl_null;
+    jl_tuple_t *newsig=NULL;
+    size_t i;
+    JL_GC_PUSH(&env, &newsig);
+
+    if (m->invokes == NULL) {
+        m->invokes = new_method_table();
+        // this private method table has just this one definition
+        jl_method_list_insert(&m->invokes->defs,m->sig,m->func,m->tvars,0);
+    }
+
+    newsig = (jl_tuple_t*)m->sig;
+
+    if (env != (jl_value_t*)jl_false) {
+        tpenv = (jl_tuple_t*)env;
+        // don't bother computing this if no arguments are tuples
+        for(i=0; i < tt->length; i++) {
+            if (jl_is_tuple(jl_tupleref(tt,i)))
+                break;
+        }
+        if (i < tt->length) {
+            newsig =
+                (jl_tuple_t*)jl_instantiate_type_with((jl_type_t*)m->sig,
+                                                      &jl_tupleref(tpenv,0),
+                                                      tpenv->length/2);
+        }
+    }
+    jl_function_t *mfunc = cache_method(m->invokes, tt, m->func, newsig, tpenv);
+    JL_GC_POP();
+    return mfunc;
+}
+
+jl_value_t *jl_gf_invoke(jl_function_t *gf, jl_tuple_t *types,
+                         jl_value_t **args, size_t nargs)
+{
+    assert(jl_is_gf(gf));
+    jl_methtable_t *mt = jl_gf_mtable(gf);
+
+    jl_value_t *env;
+    jl_methlist_t *m = invoke_lookup(mt, types, &env);
 
     if (m == NULL) {
         return jl_no_method_error(gf, args, nargs);
@@ -1228,36 +1964,10 @@ jl_value_t *jl_gf_invoke(jl_function_t *gf, jl_tuple_t *types,
         }
     }
     else {
-        jl_tuple_t *tpenv=jl_null;
-        jl_tuple_t *newsig=NULL;
         jl_tuple_t *tt=NULL;
-        JL_GC_PUSH(&env, &newsig, &tt);
-
-        if (m->invokes == NULL) {
-            m->invokes = new_method_table();
-            // this private method table has just this one definition
-            jl_method_list_insert(&m->invokes->defs,m->sig,m->func,m->tvars,0);
-        }
-
+        JL_GC_PUSH(&env, &tt);
         tt = arg_type_tuple(args, nargs);
-
-        newsig = (jl_tuple_t*)m->sig;
-
-        if (env != (jl_value_t*)jl_false) {
-            tpenv = (jl_tuple_t*)env;
-            // don't bother computing this if no arguments are tuples
-            for(i=0; i < tt->length; i++) {
-                if (jl_is_tuple(jl_tupleref(tt,i)))
-                    break;
-            }
-            if (i < tt->length) {
-                newsig =
-                    (jl_tuple_t*)jl_instantiate_type_with((jl_type_t*)m->sig,
-                                                          &jl_tupleref(tpenv,0),
-                                                          tpenv->length/2);
-            }
-        }
-        mfunc = cache_method(m->invokes, tt, m->func, newsig, tpenv);
+        mfunc = invoke_specialize(m, env, tt);
         JL_GC_POP();
     }
 
@@ -1267,6 +1977,42 @@ jl_value_t *jl_gf_invoke(jl_function_t *gf, jl_tuple_t *types,
     return result;
 }
 
+// compiled specialization that invoke(gf, types, args...) would call for
+// arguments of the given leaf types, or NULL. used by codegen to resolve
+// invoke() calls with constant signatures.
+jl_function_t *jl_get_invoke_specialization(jl_function_t *gf,
+                                            jl_tuple_t *types,
+                                            jl_tuple_t *argtypes)
+{
+    assert(jl_is_gf(gf));
+    if (!jl_is_leaf_type((jl_value_t*)argtypes))
+        return NULL;
+    if (!jl_tuple_subtype(&jl_tupleref(argtypes,0), argtypes->length,
+                          &jl_tupleref(types,0), types->length, 0, 0))
+        return NULL;
+    jl_value_t *env;
+    jl_methlist_t *m = invoke_lookup(jl_gf_mtable(gf), types, &env);
+    if (m == NULL)
+        return NULL;
+    jl_function_t *sf = NULL;
+    if (m->invokes != NULL)
+        sf = jl_method_table_assoc_exact_by_type(m->invokes, argtypes);
+    if (sf == NULL) {
+        JL_GC_PUSH(&env);
+        sf = invoke_specialize(m, env, argtypes);
+        JL_GC_POP();
+    }
+    if (sf->linfo == NULL || sf->linfo->ast == NULL)
+        return NULL;
+    if (sf->linfo->inInference) return NULL;
+    if (sf->linfo->functionObject == NULL) {
+        if (sf->fptr != &jl_trampoline)
+            return NULL;
+        jl_compile(sf);
+    }
+    return sf;
+}
+
 static void print_methlist(char *name, jl_methlist_t *ml)
 {
     ios_t *s = jl_current_output_stream();
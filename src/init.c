@@ -113,6 +113,8 @@ void julia_init(char *imageFile)
     jl_init_types();
     jl_init_tasks(jl_stack_lo, jl_stack_hi-jl_stack_lo);
     jl_init_codegen();
+    jl_init_specialization_limit();
+    jl_init_tiering();
     jl_an_empty_cell = (jl_value_t*)jl_alloc_cell_1d(0);
 
     jl_init_serializer();
@@ -6,7 +6,7 @@
 
 static jl_value_t *eval(jl_value_t *e, jl_value_t **locals, size_t nl);
 static jl_value_t *eval_body(jl_array_t *stmts, jl_value_t **locals, size_t nl,
-                             int start);
+                             int start, jl_lambda_info_t *li);
 
 jl_value_t *jl_interpret_toplevel_expr(jl_value_t *e)
 {
@@ -132,7 +132,7 @@ static jl_value_t *eval(jl_value_t *e, jl_value_t **locals, size_t nl)
         return (jl_value_t*)jl_nothing;
     }
     else if (ex->head == body_sym) {
-        return eval_body(ex->args, locals, nl, 0);
+        return eval_body(ex->args, locals, nl, 0, NULL);
     }
     else if (ex->head == exc_sym) {
         return jl_exception_in_transit;
@@ -186,6 +186,9 @@ static jl_value_t *eval(jl_value_t *e, jl_value_t **locals, size_t nl)
     else if (ex->head == multivalue_sym) {
         return (jl_value_t*)jl_nothing;
     }
+    else if (ex->head == boundscheck_sym) {
+        return (jl_value_t*)jl_nothing;
+    }
     jl_error("not supported");
     return (jl_value_t*)jl_nothing;
 }
@@ -203,8 +206,10 @@ static int label_idx(jl_value_t *tgt, jl_array_t *stmts)
     return j;
 }
 
+// li, if given, is the function whose body this is. backward branches
+// are counted against it.
 static jl_value_t *eval_body(jl_array_t *stmts, jl_value_t **locals, size_t nl,
-                             int start)
+                             int start, jl_lambda_info_t *li)
 {
     jl_savestate_t __ss;
     jmp_buf __handlr;
@@ -212,7 +217,10 @@ static jl_value_t *eval_body(jl_array_t *stmts, jl_value_t **locals, size_t nl,
     while (1) {
         jl_value_t *stmt = jl_cellref(stmts,i);
         if (jl_is_gotonode(stmt)) {
-            i = label_idx(jl_fieldref(stmt,0), stmts);
+            size_t j = label_idx(jl_fieldref(stmt,0), stmts);
+            if (li && j <= i)
+                li->nticks++;
+            i = j;
             continue;
         }
         if (jl_is_expr(stmt)) {
@@ -220,7 +228,10 @@ static jl_value_t *eval_body(jl_array_t *stmts, jl_value_t **locals, size_t nl,
             if (head == goto_ifnot_sym) {
                 jl_value_t *cond = eval(jl_exprarg(stmt,0), locals, nl);
                 if (cond == jl_false) {
-                    i = label_idx(jl_exprarg(stmt,1), stmts);
+                    size_t j = label_idx(jl_exprarg(stmt,1), stmts);
+                    if (li && j <= i)
+                        li->nticks++;
+                    i = j;
                     continue;
                 }
             }
@@ -230,7 +241,7 @@ static jl_value_t *eval_body(jl_array_t *stmts, jl_value_t **locals, size_t nl,
             else if (head == enter_sym) {
                 jl_enter_handler(&__ss, &__handlr);
                 if (!setjmp(__handlr)) {
-                    return eval_body(stmts, locals, nl, i+1);
+                    return eval_body(stmts, locals, nl, i+1, li);
                 }
                 else {
                     i = label_idx(jl_exprarg(stmt,0), stmts);
@@ -274,7 +285,7 @@ jl_value_t *jl_interpret_toplevel_thunk_with(jl_lambda_info_t *lam,
         locals[i*2+1] = loc[(i-l->length)*2+1];
     }
     JL_GC_PUSHARGS(locals, nl*2);
-    r = eval_body(stmts, locals, nl, 0);
+    r = eval_body(stmts, locals, nl, 0, NULL);
     JL_GC_POP();
     return r;
 }
@@ -283,3 +294,178 @@ jl_value_t *jl_interpret_toplevel_thunk(jl_lambda_info_t *lam)
 {
     return jl_interpret_toplevel_thunk_with(lam, NULL, 0);
 }
+
+// tiered execution -----------------------------------------------------------
+
+/*
+  with a tier threshold set, a function that has not been compiled yet is
+  run by the interpreter until its calls plus backward branches taken reach
+  the threshold, and compiled on the call after that. code that runs only
+  a few times never pays for LLVM. a function already running in the
+  interpreter finishes there; only its next call is compiled.
+*/
+
+static uint32_t tier_threshold = 0;  // 0: compile on first call
+static size_t n_interpreted = 0;
+static size_t n_promoted = 0;
+
+DLLEXPORT void jl_set_tier_threshold(uint32_t n)
+{
+    tier_threshold = n;
+}
+
+// calls run by the interpreter, functions compiled after interpretation,
+// current threshold
+DLLEXPORT void jl_tier_stats(size_t *counts)
+{
+    counts[0] = n_interpreted;
+    counts[1] = n_promoted;
+    counts[2] = tier_threshold;
+}
+
+void jl_init_tiering(void)
+{
+    char *t = getenv("JULIA_TIER_THRESHOLD");
+    if (t)
+        jl_set_tier_threshold(strtoul(t, NULL, 10));
+}
+
+static int interp_call_ok(jl_value_t *f, jl_module_t *m)
+{
+    if (jl_is_symbolnode(f))
+        f = (jl_value_t*)jl_symbolnode_sym(f);
+    else if (jl_is_topnode(f))
+        f = jl_fieldref(f,0);
+    if (jl_is_symbol(f)) {
+        jl_value_t *v = jl_get_global(m, (jl_sym_t*)f);
+        if (v != NULL && jl_typeis(v, jl_intrinsic_type))
+            return 0;
+    }
+    return 1;
+}
+
+// whether every form in e can be evaluated by eval() with the same
+// meaning it has in compiled code
+static int interp_supported(jl_value_t *e, jl_module_t *m)
+{
+    if (jl_is_lambda_info(e)) {
+        // inner functions get an empty environment from the interpreter
+        jl_value_t *ast = ((jl_lambda_info_t*)e)->ast;
+        return jl_lam_capt((jl_expr_t*)ast)->length == 0;
+    }
+    if (!jl_is_expr(e))
+        return 1;
+    jl_expr_t *ex = (jl_expr_t*)e;
+    jl_sym_t *h = ex->head;
+    if (h == call_sym || h == call1_sym) {
+        if (!interp_call_ok(jl_exprarg(ex,0), m))
+            return 0;
+    }
+    else if (!(h == assign_sym || h == new_sym || h == null_sym ||
+               h == body_sym || h == exc_sym ||
+               h == method_sym || h == const_sym || h == error_sym ||
+               h == line_sym || h == multivalue_sym || h == goto_ifnot_sym ||
+               h == return_sym || h == enter_sym || h == leave_sym ||
+               h == boundscheck_sym)) {
+        return 0;
+    }
+    size_t i;
+    for(i=0; i < ex->args->length; i++) {
+        if (!interp_supported(jl_exprarg(ex,i), m))
+            return 0;
+    }
+    return 1;
+}
+
+static int interpretable(jl_lambda_info_t *li)
+{
+    if (li->interp == 0) {
+        li->interp = 2;
+        if (li->ast != NULL && jl_is_expr(li->ast)) {
+            jl_expr_t *ast = (jl_expr_t*)li->ast;
+            jl_array_t *vinfos = jl_lam_vinfo(ast);
+            size_t i;
+            for(i=0; i < vinfos->length; i++) {
+                if (jl_vinfo_capt((jl_array_t*)jl_cellref(vinfos,i)))
+                    return 0;
+            }
+            if (jl_lam_capt(ast)->length == 0 &&
+                interp_supported((jl_value_t*)jl_lam_body(ast), li->module))
+                li->interp = 1;
+        }
+    }
+    return li->interp == 1;
+}
+
+// if f should still run in the interpreter, do so and return 1
+int jl_tiered_apply(jl_function_t *f, jl_value_t **args, uint32_t nargs,
+                    jl_value_t **presult)
+{
+    jl_lambda_info_t *li = f->linfo;
+    if (tier_threshold == 0 || li->functionObject != NULL)
+        return 0;
+    if (li->nticks >= tier_threshold) {
+        if (li->interp == 1)
+            n_promoted++;
+        return 0;
+    }
+    if (!interpretable(li))
+        return 0;
+    li->nticks++;
+    n_interpreted++;
+    *presult = jl_interpret_function(f, args, nargs);
+    return 1;
+}
+
+// run a function body in the interpreter
+jl_value_t *jl_interpret_function(jl_function_t *f, jl_value_t **args,
+                                  uint32_t nargs)
+{
+    jl_lambda_info_t *li = f->linfo;
+    jl_expr_t *ast = (jl_expr_t*)li->ast;
+    jl_array_t *formals = jl_lam_args(ast);
+    jl_array_t *l = jl_lam_locals(ast);
+    size_t nf = formals->length;
+    size_t nsp = li->sparams->length/2;
+    size_t nl = nf + l->length + nsp;
+    int va = (nf > 0 && jl_is_rest_arg(jl_cellref(formals,nf-1)));
+    if (va) {
+        if (nargs < nf-1)
+            jl_error("too few arguments");
+    }
+    else if (nargs != nf) {
+        jl_error("wrong number of arguments");
+    }
+    jl_value_t **locals = (jl_value_t**)alloca(nl*2*sizeof(void*));
+    size_t i, n=0;
+    for(i=0; i < nf; i++, n++) {
+        locals[n*2]   = (jl_value_t*)jl_decl_var(jl_cellref(formals,i));
+        locals[n*2+1] = (va && i == nf-1) ? NULL : args[i];
+    }
+    for(i=0; i < l->length; i++, n++) {
+        locals[n*2]   = jl_cellref(l,i);
+        locals[n*2+1] = NULL;
+    }
+    for(i=0; i < nsp; i++, n++) {
+        locals[n*2]   = jl_tupleref(li->sparams, i*2);
+        locals[n*2+1] = jl_tupleref(li->sparams, i*2+1);
+    }
+    JL_GC_PUSHARGS(locals, nl*2);
+    if (va) {
+        locals[(nf-1)*2+1] =
+            (jl_value_t*)jl_f_tuple(NULL, &args[nf-1], nargs-(nf-1));
+    }
+    jl_value_t *r = NULL;
+    jl_module_t *last_m = jl_current_module;
+    JL_TRY {
+        jl_current_module = li->module;
+        r = eval_body(jl_lam_body(ast)->args, locals, nl, 0, li);
+    }
+    JL_CATCH {
+        jl_current_module = last_m;
+        jl_raise(jl_exception_in_transit);
+    }
+    jl_current_module = last_m;
+    JL_GC_POP();
+    return r;
+}
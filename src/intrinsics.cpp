@@ -35,6 +35,13 @@ namespace JL_I {
         abs_float32, abs_float64,
         copysign_float32, copysign_float64,
         flipsign_int32, flipsign_int64,
+        // short vectors
+        vadd_int, vsub_int, vmul_int,
+        vadd_float, vsub_float, vmul_float, vdiv_float,
+        veq_int, vslt_int, vsle_int,
+        veq_float, vlt_float, vle_float,
+        vselect, vshuffle, vsplat, vextract, vinsert,
+        vload, vstore,
         // c interface
         ccall,
     };
@@ -271,6 +278,215 @@ static Value *generic_zext(jl_value_t *targ, jl_value_t *x, jl_codectx_t *ctx)
     return builder.CreateZExt(INT(auto_unbox(x,ctx)), to);
 }
 
+/*
+  short vector intrinsics:
+  a vector is an ordinary bits type whose width is a multiple of its
+  element size (e.g. bitstype 256 Float64x4). the element type is given
+  as the first argument, the same way box takes its target type, and the
+  lane count follows from the bit width. operands are reinterpreted as
+  LLVM vectors on the way in and as plain bits on the way out, so they
+  box, unbox and pass through ccall like any other bits type; the bitcasts
+  between consecutive vector operations fold away.
+*/
+
+static jl_value_t *static_arg(jl_value_t *e, jl_codectx_t *ctx)
+{
+    return jl_interpret_toplevel_expr_in(ctx->module, e,
+                                         &jl_tupleref(ctx->sp,0),
+                                         ctx->sp->length/2);
+}
+
+static Type *vector_elt_type(jl_value_t *targ, const char *fname,
+                             jl_codectx_t *ctx)
+{
+    jl_value_t *et = static_arg(targ, ctx);
+    if (!jl_is_bits_type(et) || et == (jl_value_t*)jl_bool_type ||
+        jl_is_cpointer_type(et))
+        jl_errorf("%s: expected number type as first argument", fname);
+    return julia_type_to_llvm(et, ctx);
+}
+
+static size_t vector_lanes(jl_value_t *e, const char *fname, jl_codectx_t *ctx)
+{
+    jl_value_t *n = static_arg(e, ctx);
+    if (!jl_is_long(n) || jl_unbox_long(n) < 1)
+        jl_errorf("%s: lane count must be a positive integer constant", fname);
+    return jl_unbox_long(n);
+}
+
+// reinterpret the bits of x as a vector of et
+static Value *as_vector(Type *et, Value *x, const char *fname)
+{
+    x = INT(x);
+    unsigned nb = x->getType()->getPrimitiveSizeInBits();
+    unsigned eb = et->getPrimitiveSizeInBits();
+    if (nb < 2*eb || nb%eb != 0)
+        jl_errorf("%s: expected a vector of %d-bit elements", fname, eb);
+    return builder.CreateBitCast(x, VectorType::get(et, nb/eb));
+}
+
+static Value *from_vector(Value *v)
+{
+    return builder.CreateBitCast(v, IntegerType::get(jl_LLVMContext,
+                                                     v->getType()->getPrimitiveSizeInBits()));
+}
+
+// comparisons give all-ones or all-zeros lanes, like SSE masks
+static Value *vector_mask(Value *c, Value *v)
+{
+    return from_vector(builder.CreateSExt(c, VectorType::getInteger(cast<VectorType>(v->getType()))));
+}
+
+static Value *vector_ptr(Value *p, Type *vt)
+{
+    p = INT(p);
+    return builder.CreateIntToPtr(p, PointerType::get(vt, 0));
+}
+
+static Value *emit_vector_intrinsic(intrinsic f, jl_value_t **args,
+                                    size_t nargs, jl_codectx_t *ctx)
+{
+    static const char *const names[] = {
+        "vadd_int", "vsub_int", "vmul_int",
+        "vadd_float", "vsub_float", "vmul_float", "vdiv_float",
+        "veq_int", "vslt_int", "vsle_int",
+        "veq_float", "vlt_float", "vle_float",
+        "vselect", "vshuffle", "vsplat", "vextract", "vinsert",
+        "vload", "vstore" };
+    const char *fname = names[f - vadd_int];
+    if (nargs < 2)
+        jl_errorf("%s: wrong number of arguments", fname);
+    Type *et = vector_elt_type(args[1], fname, ctx);
+    unsigned eb = et->getPrimitiveSizeInBits();
+    Value *x, *y, *m;
+    switch (f) {
+    case vadd_int: case vsub_int: case vmul_int:
+    case vadd_float: case vsub_float: case vmul_float: case vdiv_float:
+    case veq_int: case vslt_int: case vsle_int:
+    case veq_float: case vlt_float: case vle_float:
+        if (nargs != 3)
+            jl_errorf("%s: wrong number of arguments", fname);
+        x = as_vector(et, auto_unbox(args[2],ctx), fname);
+        y = as_vector(et, auto_unbox(args[3],ctx), fname);
+        if (x->getType() != y->getType())
+            jl_errorf("%s: vector widths do not match", fname);
+        switch (f) {
+        case vadd_int:   return from_vector(builder.CreateAdd(x, y));
+        case vsub_int:   return from_vector(builder.CreateSub(x, y));
+        case vmul_int:   return from_vector(builder.CreateMul(x, y));
+        case vadd_float: return from_vector(builder.CreateFAdd(x, y));
+        case vsub_float: return from_vector(builder.CreateFSub(x, y));
+        case vmul_float: return from_vector(builder.CreateFMul(x, y));
+        case vdiv_float: return from_vector(builder.CreateFDiv(x, y));
+        case veq_int:    return vector_mask(builder.CreateICmpEQ(x, y), x);
+        case vslt_int:   return vector_mask(builder.CreateICmpSLT(x, y), x);
+        case vsle_int:   return vector_mask(builder.CreateICmpSLE(x, y), x);
+        case veq_float:  return vector_mask(builder.CreateFCmpOEQ(x, y), x);
+        case vlt_float:  return vector_mask(builder.CreateFCmpOLT(x, y), x);
+        case vle_float:  return vector_mask(builder.CreateFCmpOLE(x, y), x);
+        default: ;
+        }
+        break;
+    case vselect:
+        // vselect(T, mask, x, y): lanes of x where mask is nonzero, else y
+        if (nargs != 4)
+            jl_errorf("%s: wrong number of arguments", fname);
+        x = as_vector(et, auto_unbox(args[3],ctx), fname);
+        y = as_vector(et, auto_unbox(args[4],ctx), fname);
+        m = as_vector(IntegerType::get(jl_LLVMContext, eb),
+                      auto_unbox(args[2],ctx), fname);
+        if (x->getType() != y->getType() ||
+            m->getType() != VectorType::getInteger(cast<VectorType>(x->getType())))
+            jl_errorf("%s: vector widths do not match", fname);
+        return from_vector(builder.CreateSelect(
+            builder.CreateICmpNE(m, ConstantAggregateZero::get(m->getType())),
+            x, y));
+    case vshuffle:
+    {
+        // vshuffle(T, x, y, i...): lane i of the concatenation of x and y
+        if (nargs < 5)
+            jl_errorf("%s: wrong number of arguments", fname);
+        x = as_vector(et, auto_unbox(args[2],ctx), fname);
+        y = as_vector(et, auto_unbox(args[3],ctx), fname);
+        if (x->getType() != y->getType())
+            jl_errorf("%s: vector widths do not match", fname);
+        size_t n = cast<VectorType>(x->getType())->getNumElements();
+        std::vector<Constant*> mask(0);
+        for(size_t i=4; i <= nargs; i++) {
+            size_t k = vector_lanes(args[i], fname, ctx);
+            if (k > 2*n)
+                jl_errorf("%s: lane index out of range", fname);
+            mask.push_back(ConstantInt::get(T_int32, k-1));
+        }
+        return from_vector(builder.CreateShuffleVector(x, y,
+                                                       ConstantVector::get(mask)));
+    }
+    case vsplat:
+    {
+        // vsplat(T, n, x): n copies of the scalar x
+        if (nargs != 3)
+            jl_errorf("%s: wrong number of arguments", fname);
+        size_t n = vector_lanes(args[2], fname, ctx);
+        x = INT(auto_unbox(args[3],ctx));
+        if (x->getType()->getPrimitiveSizeInBits() != eb)
+            jl_errorf("%s: expected %d-bit scalar", fname, eb);
+        Type *vt = VectorType::get(et, n);
+        Value *v = builder.CreateInsertElement(UndefValue::get(vt),
+                                               builder.CreateBitCast(x, et),
+                                               ConstantInt::get(T_int32, 0));
+        Type *mt = VectorType::get(T_int32, n);
+        return from_vector(builder.CreateShuffleVector(v, UndefValue::get(vt),
+                                                       ConstantAggregateZero::get(mt)));
+    }
+    case vextract:
+    case vinsert:
+    {
+        // vextract(T, v, i) and vinsert(T, v, x, i), with 1-based i
+        if (nargs != (f == vextract ? 3 : 4))
+            jl_errorf("%s: wrong number of arguments", fname);
+        x = as_vector(et, auto_unbox(args[2],ctx), fname);
+        size_t n = cast<VectorType>(x->getType())->getNumElements();
+        Value *idx = uint_cnvt(T_size, INT(auto_unbox(args[nargs],ctx)));
+        idx = emit_bounds_check(idx, ConstantInt::get(T_size, n),
+                                std::string(fname)+": index out of range", ctx);
+        idx = uint_cnvt(T_int32, idx);
+        if (f == vextract)
+            return builder.CreateExtractElement(x, idx);
+        y = INT(auto_unbox(args[3],ctx));
+        if (y->getType()->getPrimitiveSizeInBits() != eb)
+            jl_errorf("%s: expected %d-bit scalar", fname, eb);
+        return from_vector(builder.CreateInsertElement(x, builder.CreateBitCast(y, et),
+                                                       idx));
+    }
+    case vload:
+    {
+        // vload(T, n, p::Ptr{T}): n elements starting at p. arrays only
+        // guarantee element alignment.
+        if (nargs != 3)
+            jl_errorf("%s: wrong number of arguments", fname);
+        Type *vt = VectorType::get(et, vector_lanes(args[2], fname, ctx));
+        LoadInst *ld = builder.CreateLoad(vector_ptr(auto_unbox(args[3],ctx), vt),
+                                          false);
+        ld->setAlignment(eb/8);
+        return from_vector(ld);
+    }
+    case vstore:
+    {
+        // vstore(T, p::Ptr{T}, v)
+        if (nargs != 3)
+            jl_errorf("%s: wrong number of arguments", fname);
+        Value *p = auto_unbox(args[2],ctx);
+        x = as_vector(et, auto_unbox(args[3],ctx), fname);
+        StoreInst *st = builder.CreateStore(x, vector_ptr(p, x->getType()));
+        st->setAlignment(eb/8);
+        return literal_pointer_val(jl_nothing);
+    }
+    default: ;
+    }
+    assert(false);
+    return NULL;
+}
+
 #define HANDLE(intr,n)                                                  \
     case intr: if (nargs!=n) jl_error(#intr": wrong number of arguments");
 
@@ -298,6 +514,8 @@ static Value *emit_intrinsic(intrinsic f, jl_value_t **args, size_t nargs,
             jl_error("zext_int: wrong number of arguments");
         return generic_zext(args[1], args[2], ctx);
     }
+    if (f >= vadd_int && f <= vstore)
+        return emit_vector_intrinsic(f, args, nargs, ctx);
     switch (f) {
         HANDLE(unbox8,1)
             return emit_unbox(T_int8, T_pint8, emit_unboxed(args[1],ctx));
@@ -906,5 +1124,12 @@ extern "C" void jl_init_intrinsic_functions(void)
     ADD_I(abs_float32); ADD_I(abs_float64);
     ADD_I(copysign_float32); ADD_I(copysign_float64);
     ADD_I(flipsign_int32); ADD_I(flipsign_int64);
+    ADD_I(vadd_int); ADD_I(vsub_int); ADD_I(vmul_int);
+    ADD_I(vadd_float); ADD_I(vsub_float); ADD_I(vmul_float); ADD_I(vdiv_float);
+    ADD_I(veq_int); ADD_I(vslt_int); ADD_I(vsle_int);
+    ADD_I(veq_float); ADD_I(vlt_float); ADD_I(vle_float);
+    ADD_I(vselect); ADD_I(vshuffle); ADD_I(vsplat);
+    ADD_I(vextract); ADD_I(vinsert);
+    ADD_I(vload); ADD_I(vstore);
     ADD_I(ccall);
 }
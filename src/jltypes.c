@@ -784,12 +784,132 @@ static jl_value_t *jl_type_intersect(jl_value_t *a, jl_value_t *b,
     return result;
 }
 
+// --- memo cache for subtype and intersection queries ---
+
+/*
+  a direct-mapped cache of results for pairs of tag types, which are
+  hash-consed so a pair of pointers identifies the query. the entries are
+  gc roots, so a key cannot be freed and its address reused. the cache is
+  cleared whenever a supertype is assigned, and it is not used while a
+  new type instance is only partly built, since that type can take part
+  in subtype checks with a placeholder supertype.
+*/
+#define TYPE_MEMO_SIZE 4096
+#define MEMO_SUBTYPE 1
+#define MEMO_MORESPECIFIC 2
+#define MEMO_INTERSECT 3
+
+typedef struct {
+    jl_value_t *a;
+    jl_value_t *b;
+    jl_value_t *result;
+    int kind;
+} type_memo_t;
+
+static type_memo_t type_memo[TYPE_MEMO_SIZE];
+static int partial_types = 0;
+static size_t memo_hits = 0;
+static size_t memo_misses = 0;
+static size_t memo_clears = 0;
+
+static inline int memo_ok(jl_value_t *a, jl_value_t *b)
+{
+    return (partial_types == 0 &&
+            jl_is_some_tag_type(a) && jl_is_some_tag_type(b));
+}
+
+static inline type_memo_t *memo_slot(jl_value_t *a, jl_value_t *b, int kind)
+{
+    uptrint_t h = inthash((uptrint_t)a*31 + (uptrint_t)b + kind);
+    return &type_memo[h & (TYPE_MEMO_SIZE-1)];
+}
+
+static inline jl_value_t *memo_lookup(jl_value_t *a, jl_value_t *b, int kind)
+{
+    type_memo_t *m = memo_slot(a, b, kind);
+    if (m->a == a && m->b == b && m->kind == kind) {
+        memo_hits++;
+        return m->result;
+    }
+    memo_misses++;
+    return NULL;
+}
+
+static inline void memo_store(jl_value_t *a, jl_value_t *b, int kind,
+                              jl_value_t *result)
+{
+    if (partial_types != 0)
+        return;
+    type_memo_t *m = memo_slot(a, b, kind);
+    m->a = a;
+    m->b = b;
+    m->kind = kind;
+    m->result = result;
+}
+
+static int jl_subtype_le(jl_value_t *a,jl_value_t *b,int ta,int morespecific,
+                         int invariant);
+
+static int memo_subtype(jl_value_t *a, jl_value_t *b, int morespecific)
+{
+    int kind = morespecific ? MEMO_MORESPECIFIC : MEMO_SUBTYPE;
+    jl_value_t *r = memo_lookup(a, b, kind);
+    if (r != NULL)
+        return r == jl_true;
+    int res = jl_subtype_le(a, b, 0, morespecific, 0);
+    memo_store(a, b, kind, res ? jl_true : jl_false);
+    return res;
+}
+
+// jl_subtype_le for tuple elements, through the cache when possible
+static int subtype_elt(jl_value_t *a, jl_value_t *b, int ta, int morespecific,
+                       int invariant)
+{
+    if (!ta && !invariant && a != b && memo_ok(a, b))
+        return memo_subtype(a, b, morespecific);
+    return jl_subtype_le(a, b, ta, morespecific, invariant);
+}
+
+void jl_type_memo_clear(void)
+{
+    memset(type_memo, 0, sizeof(type_memo));
+    memo_clears++;
+}
+
+void jl_mark_type_memo(void)
+{
+    size_t i;
+    for(i=0; i < TYPE_MEMO_SIZE; i++) {
+        if (type_memo[i].kind != 0) {
+            jl_gc_markval(type_memo[i].a);
+            jl_gc_markval(type_memo[i].b);
+            jl_gc_markval(type_memo[i].result);
+        }
+    }
+}
+
+// hits, misses, clears
+DLLEXPORT void jl_type_memo_stats(size_t *counts)
+{
+    counts[0] = memo_hits;
+    counts[1] = memo_misses;
+    counts[2] = memo_clears;
+}
+
 jl_value_t *jl_type_intersection(jl_value_t *a, jl_value_t *b)
 {
+    int memo = memo_ok(a, b);
+    if (memo) {
+        jl_value_t *ti = memo_lookup(a, b, MEMO_INTERSECT);
+        if (ti != NULL)
+            return ti;
+    }
     jl_tuple_t *env = jl_null;
     JL_GC_PUSH(&env);
     jl_value_t *ti = jl_type_intersection_matching(a, b, &env, jl_null);
     JL_GC_POP();
+    if (memo)
+        memo_store(a, b, MEMO_INTERSECT, ti);
     return ti;
 }
 
@@ -1319,6 +1439,150 @@ static jl_type_t *lookup_type(jl_tuple_t *table,
     return NULL;
 }
 
+/*
+  each typename caches its instances in an open-addressed table keyed on
+  the parameters. the hash must agree with type_eqv_, so it only looks at
+  type names (through their symbol's hash, which is stable across system
+  images) and integer parameters, a few levels deep.
+*/
+#define TYPE_CACHE_MINSZ 8
+#define type_cache_max_probe(sz) ((sz)<=64 ? 8 : (sz)>>3)
+
+static uptrint_t type_param_hash(jl_value_t *t, int depth)
+{
+    if (jl_is_typector(t))
+        t = (jl_value_t*)((jl_typector_t*)t)->body;
+    if (jl_is_long(t))
+        return inthash((uptrint_t)jl_unbox_long(t));
+    if (jl_is_some_tag_type(t)) {
+        jl_tag_type_t *tt = (jl_tag_type_t*)t;
+        uptrint_t h = tt->name->name->hash;
+        if (depth < 3) {
+            size_t i;
+            for(i=0; i < tt->parameters->length; i++)
+                h = inthash(h*31 + type_param_hash(jl_tupleref(tt->parameters,i),
+                                                   depth+1));
+        }
+        return h;
+    }
+    // typevars, tuples and unions are compared structurally; only their
+    // kind is hashed.
+    if (jl_is_typevar(t)) return 1;
+    if (jl_is_tuple(t)) return 2;
+    if (jl_is_union_type(t)) return 3;
+    return 4;
+}
+
+static uptrint_t type_cache_hash(jl_value_t **key, size_t n)
+{
+    uptrint_t h = n;
+    size_t i;
+    for(i=0; i < n; i++)
+        h = inthash(h*31 + type_param_hash(key[i], 1));
+    return h;
+}
+
+static int type_cache_eq(jl_tag_type_t *tt, jl_value_t **key, size_t n)
+{
+    if (n != tt->parameters->length)
+        return 0;
+    size_t i;
+    for(i=0; i < n; i++) {
+        if (!type_eqv_(jl_tupleref(tt->parameters,i), key[i]))
+            return 0;
+    }
+    return 1;
+}
+
+// types instantiated before Array{Any,1} exists, when the tables cannot
+// be allocated yet
+#define TYPE_CACHE_NBOOT 8
+static jl_tag_type_t *boot_cached[TYPE_CACHE_NBOOT];
+static size_t n_boot_cached = 0;
+
+static jl_type_t *lookup_type_cache(jl_typename_t *tn, jl_value_t **key,
+                                    size_t n)
+{
+    jl_array_t *a = tn->cache;
+    if (n == 0) return NULL;
+    if (a == NULL) {
+        size_t i;
+        for(i=0; i < n_boot_cached; i++) {
+            if (boot_cached[i]->name == tn &&
+                type_cache_eq(boot_cached[i], key, n))
+                return (jl_type_t*)boot_cached[i];
+        }
+        return NULL;
+    }
+    size_t sz = jl_array_len(a);
+    size_t maxprobe = type_cache_max_probe(sz);
+    uptrint_t h = type_cache_hash(key, n);
+    size_t p;
+    for(p=0; p < maxprobe; p++) {
+        jl_tag_type_t *tt = (jl_tag_type_t*)jl_cellref(a, (h+p) & (sz-1));
+        if (tt == NULL)
+            return NULL;
+        if (type_cache_eq(tt, key, n))
+            return (jl_type_t*)tt;
+    }
+    return NULL;
+}
+
+// returns 0 if no slot was free within the probe limit. an equivalent
+// type already in the table is replaced, so the newest instance wins.
+static int type_cache_put(jl_array_t *a, jl_tag_type_t *type)
+{
+    jl_value_t **key = &jl_tupleref(type->parameters,0);
+    size_t n = type->parameters->length;
+    size_t sz = jl_array_len(a);
+    size_t maxprobe = type_cache_max_probe(sz);
+    uptrint_t h = type_cache_hash(key, n);
+    size_t p;
+    for(p=0; p < maxprobe; p++) {
+        jl_tag_type_t **slot =
+            (jl_tag_type_t**)&jl_cellref(a, (h+p) & (sz-1));
+        if (*slot == NULL || type_cache_eq(*slot, key, n)) {
+            *slot = type;
+            jl_gc_wb_back(a);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void type_cache_insert(jl_typename_t *tn, jl_tag_type_t *type)
+{
+    if (jl_array_any_type == NULL) {
+        assert(n_boot_cached < TYPE_CACHE_NBOOT);
+        boot_cached[n_boot_cached++] = type;
+        return;
+    }
+    if (tn->cache == NULL)
+        tn->cache = jl_alloc_cell_1d(TYPE_CACHE_MINSZ);
+    if (type_cache_put(tn->cache, type))
+        return;
+    // out of room near this slot; grow until every entry fits
+    jl_array_t *old = tn->cache;
+    size_t oldsz = jl_array_len(old);
+    size_t newsz = oldsz;
+    jl_array_t *a = NULL;
+    JL_GC_PUSH(&a);
+    while (1) {
+        newsz *= 2;
+        a = jl_alloc_cell_1d(newsz);
+        size_t i;
+        for(i=0; i < oldsz; i++) {
+            jl_tag_type_t *e = (jl_tag_type_t*)jl_cellref(old, i);
+            if (e != NULL && !type_cache_put(a, e))
+                break;
+        }
+        if (i == oldsz && type_cache_put(a, type))
+            break;
+    }
+    tn->cache = a;
+    JL_GC_POP();
+}
+
 static int t_uid_ctr = 1;  // TODO: lock
 
 int  jl_get_t_uid_ctr(void) { return t_uid_ctr; }
@@ -1350,8 +1614,7 @@ static void cache_type_(jl_type_t *type)
         ((jl_struct_type_t*)type)->uid = jl_assign_type_uid();
     else if (jl_is_bits_type(type) && ((jl_bits_type_t*)type)->uid==0)
         ((jl_bits_type_t*)type)->uid = jl_assign_type_uid();
-    jl_tuple_t *tc = ((jl_tag_type_t*)type)->name->cache;
-    ((jl_tag_type_t*)type)->name->cache = jl_tuple2(type, tc);
+    type_cache_insert(((jl_tag_type_t*)type)->name, (jl_tag_type_t*)type);
 }
 
 void jl_cache_type_(jl_tag_type_t *type)
@@ -1362,6 +1625,28 @@ void jl_cache_type_(jl_tag_type_t *type)
 JL_CALLABLE(jl_f_tuple);
 JL_CALLABLE(jl_f_ctor_trampoline);
 
+static jl_type_t *inst_type_w_(jl_value_t *t, jl_value_t **env, size_t n,
+                               jl_tuple_t *stack);
+
+// instantiate the supertype of a type that is only partly built. the memo
+// cache is off meanwhile, and must come back on if this raises.
+static jl_tag_type_t *inst_partial_super(jl_tag_type_t *super,
+                                         jl_value_t **env, size_t n,
+                                         jl_tuple_t *stack)
+{
+    jl_tag_type_t *nsuper = NULL;
+    partial_types++;
+    JL_TRY {
+        nsuper = (jl_tag_type_t*)inst_type_w_((jl_value_t*)super, env, n, stack);
+    }
+    JL_CATCH {
+        partial_types--;
+        jl_raise(jl_exception_in_transit);
+    }
+    partial_types--;
+    return nsuper;
+}
+
 static jl_type_t *inst_type_w_(jl_value_t *t, jl_value_t **env, size_t n,
                                jl_tuple_t *stack)
 {
@@ -1448,7 +1733,7 @@ static jl_type_t *inst_type_w_(jl_value_t *t, jl_value_t **env, size_t n,
         if (lkup != NULL) { result = lkup; goto done_inst_tt; }
 
         // check type cache
-        lkup = lookup_type(tn->cache, tn, iparams, ntp);
+        lkup = lookup_type_cache(tn, iparams, ntp);
         if (lkup != NULL) { result = lkup; goto done_inst_tt; }
 
         // always use original type constructor
@@ -1479,7 +1764,7 @@ static jl_type_t *inst_type_w_(jl_value_t *t, jl_value_t **env, size_t n,
             ntt->linfo = NULL;
             ntt->super = jl_any_type;
             ntt->parameters = iparams_tuple;
-            ntt->super = (jl_tag_type_t*)inst_type_w_((jl_value_t*)tagt->super,env,n,stack);
+            ntt->super = inst_partial_super(tagt->super, env, n, stack);
             cache_type_((jl_type_t*)ntt);
             result = (jl_type_t*)ntt;
         }
@@ -1499,7 +1784,7 @@ static jl_type_t *inst_type_w_(jl_value_t *t, jl_value_t **env, size_t n,
             nbt->parameters = iparams_tuple;
             nbt->nbits = bitst->nbits;
             nbt->bnbits = bitst->bnbits;
-            nbt->super = (jl_tag_type_t*)inst_type_w_((jl_value_t*)bitst->super, env, n, stack);
+            nbt->super = inst_partial_super(bitst->super, env, n, stack);
             nbt->uid = 0;
             cache_type_((jl_type_t*)nbt);
             result = (jl_type_t*)nbt;
@@ -1528,7 +1813,7 @@ static jl_type_t *inst_type_w_(jl_value_t *t, jl_value_t **env, size_t n,
             nst->ctor_factory = st->ctor_factory;
             nst->instance = NULL;
             nst->uid = 0;
-            nst->super = (jl_tag_type_t*)inst_type_w_((jl_value_t*)st->super, env,n,stack);
+            nst->super = inst_partial_super(st->super, env, n, stack);
             jl_tuple_t *ftypes = st->types;
             if (ftypes != NULL) {
                 // recursively instantiate the types of the fields
@@ -1605,7 +1890,7 @@ static int jl_tuple_subtype_(jl_value_t **child, size_t cl,
         if (cseq) ce = jl_tparam0(ce);
         if (pseq) pe = jl_tparam0(pe);
 
-        if (!jl_subtype_le(ce, pe, ta, morespecific, invariant))
+        if (!subtype_elt(ce, pe, ta, morespecific, invariant))
             return 0;
 
         if (morespecific) {
@@ -1843,6 +2128,8 @@ static int jl_subtype_le(jl_value_t *a, jl_value_t *b, int ta, int morespecific,
 
 int jl_subtype(jl_value_t *a, jl_value_t *b, int ta)
 {
+    if (!ta && a != b && memo_ok(a, b))
+        return memo_subtype(a, b, 0);
     return jl_subtype_le(a, b, ta, 0, 0);
 }
 
@@ -1853,6 +2140,8 @@ int jl_subtype_invariant(jl_value_t *a, jl_value_t *b, int ta)
 
 int jl_type_morespecific(jl_value_t *a, jl_value_t *b, int ta)
 {
+    if (!ta && a != b && memo_ok(a, b))
+        return memo_subtype(a, b, 1);
     return jl_subtype_le(a, b, ta, 1, 0);
 }
 
@@ -2175,6 +2464,7 @@ extern void jl_init_int32_int64_cache(void);
 
 void jl_init_types(void)
 {
+    size_t i;
     // create base objects
     jl_struct_kind = (jl_struct_type_t*)newobj(NULL, STRUCT_TYPE_NW);
     jl_struct_kind->type = (jl_type_t*)jl_struct_kind;
@@ -2230,7 +2520,7 @@ void jl_init_types(void)
     jl_typename_type->names = jl_tuple(3, jl_symbol("name"), jl_symbol(""),
                                        jl_symbol(""));
     jl_typename_type->types = jl_tuple(3, jl_sym_type, jl_type_type,
-                                       jl_tuple_type);
+                                       jl_any_type);
     jl_typename_type->uid = jl_assign_type_uid();
     jl_typename_type->fptr = jl_f_no_function;
     jl_typename_type->env = NULL;
@@ -2272,12 +2562,15 @@ void jl_init_types(void)
 
     jl_methtable_type =
         jl_new_struct_type(jl_symbol("MethodTable"), jl_any_type, jl_null,
-                           jl_tuple(5, jl_symbol("defs"), jl_symbol("cache"),
+                           jl_tuple(7, jl_symbol("defs"), jl_symbol("cache"),
                                     jl_symbol("cache_arg1"),
                                     jl_symbol("cache_targ"),
+                                    jl_symbol("cache_hash"),
+                                    jl_symbol("invoke_cache"),
                                     jl_symbol("max_args")),
-                           jl_tuple(5, jl_any_type, jl_any_type, jl_any_type,
-                                    jl_any_type, jl_long_type));
+                           jl_tuple(7, jl_any_type, jl_any_type, jl_any_type,
+                                    jl_any_type, jl_any_type, jl_any_type,
+                                    jl_long_type));
     jl_methtable_type->fptr = jl_f_no_function;
 
     jl_union_kind = jl_new_struct_type(jl_symbol("UnionKind"),
@@ -2380,6 +2673,9 @@ void jl_init_types(void)
         (jl_type_t*)jl_apply_type((jl_value_t*)jl_array_type,
                                   jl_tuple(2, jl_any_type,
                                            jl_box_long(1)));
+    for(i=0; i < n_boot_cached; i++)
+        type_cache_insert(boot_cached[i]->name, boot_cached[i]);
+    n_boot_cached = 0;
 
     jl_expr_type =
         jl_new_struct_type(jl_symbol("Expr"),
@@ -2508,6 +2804,7 @@ void jl_init_types(void)
     enter_sym = jl_symbol("enter");
     leave_sym = jl_symbol("leave");
     static_typeof_sym = jl_symbol("static_typeof");
+    boundscheck_sym = jl_symbol("boundscheck");
     new_sym = jl_symbol("new");
     multivalue_sym = jl_symbol("multiple_value");
     const_sym = jl_symbol("const");
@@ -18,8 +18,6 @@ typedef struct _jl_value_t {
 
 typedef struct _jl_sym_t {
     JL_STRUCT_TYPE
-    struct _jl_sym_t *left;
-    struct _jl_sym_t *right;
     uptrint_t hash;    // precomputed hash value
     union {
         char name[1];
@@ -100,6 +98,15 @@ typedef struct _jl_lambda_info_t {
     // used to avoid infinite recursion
     uptrint_t inInference : 1;
     uptrint_t inCompile : 1;
+    // whether the interpreter can run this function: 0 not yet known,
+    // 1 yes, 2 no
+    uptrint_t interp : 2;
+    // calls and loop iterations spent in the interpreter, for deciding
+    // when to compile
+    uint32_t nticks;
+    // LLVM optimization level forced for this function, or -1 to use the
+    // global level
+    int32_t optlevel;
 } jl_lambda_info_t;
 
 #define LAMBDA_INFO_NW (NWORDS(sizeof(jl_lambda_info_t))-1)
@@ -128,7 +135,7 @@ typedef struct {
     // a type alias, for example, might make a type constructor that is
     // not the original.
     jl_value_t *primary;
-    jl_tuple_t *cache;
+    jl_array_t *cache;
 } jl_typename_t;
 
 typedef struct {
@@ -222,18 +229,15 @@ typedef struct _jl_methlist_t {
     struct _jl_methlist_t *next;
 } jl_methlist_t;
 
-//#define JL_GF_PROFILE
-
 typedef struct _jl_methtable_t {
     JL_STRUCT_TYPE
     jl_methlist_t *defs;
     jl_methlist_t *cache;
     jl_array_t *cache_arg1;
     jl_array_t *cache_targ;
+    jl_array_t *cache_hash;
+    jl_array_t *invoke_cache;  // (types, def, env) triples found by invoke()
     jl_value_t *max_args;  // max # of non-vararg arguments in a signature
-#ifdef JL_GF_PROFILE
-    int ncalls;
-#endif
 } jl_methtable_t;
 
 typedef struct {
@@ -352,7 +356,7 @@ extern jl_sym_t *null_sym;    extern jl_sym_t *body_sym;
 extern jl_sym_t *macro_sym;   extern jl_sym_t *method_sym;
 extern jl_sym_t *enter_sym;   extern jl_sym_t *leave_sym;
 extern jl_sym_t *exc_sym;     extern jl_sym_t *new_sym;
-extern jl_sym_t *static_typeof_sym;
+extern jl_sym_t *static_typeof_sym; extern jl_sym_t *boundscheck_sym;
 extern jl_sym_t *const_sym;   extern jl_sym_t *thunk_sym;
 extern jl_sym_t *anonymous_sym;  extern jl_sym_t *underscore_sym;
 
@@ -364,9 +368,11 @@ extern jl_sym_t *anonymous_sym;  extern jl_sym_t *underscore_sym;
 
 #ifdef JL_GC_MARKSWEEP
 void *allocb(size_t sz);
+void *allocb_zeroed(size_t sz);
 void *allocobj(size_t sz);
 #else
 #define allocb(nb)    malloc(nb)
+#define allocb_zeroed(nb) calloc(1,nb)
 #define allocobj(nb)  malloc(nb)
 #endif
 
@@ -523,6 +529,7 @@ jl_value_t *jl_type_intersection_matching(jl_value_t *a, jl_value_t *b,
                                           jl_tuple_t **penv, jl_tuple_t *tvars);
 DLLEXPORT jl_value_t *jl_type_intersection(jl_value_t *a, jl_value_t *b);
 int jl_args_morespecific(jl_value_t *a, jl_value_t *b);
+void jl_type_memo_clear(void);
 
 // type constructors
 jl_typename_t *jl_new_typename(jl_sym_t *name);
@@ -559,7 +566,7 @@ jl_tuple_t *jl_tuple_fill(size_t n, jl_value_t *v);
 DLLEXPORT jl_sym_t *jl_symbol(const char *str);
 DLLEXPORT jl_sym_t *jl_symbol_n(const char *str, int32_t len);
 DLLEXPORT jl_sym_t *jl_gensym(void);
-jl_sym_t *jl_get_root_symbol(void);
+DLLEXPORT jl_sym_t **jl_get_symtab(size_t *psz);
 jl_expr_t *jl_exprn(jl_sym_t *head, size_t n);
 jl_function_t *jl_new_generic_function(jl_sym_t *name);
 void jl_initialize_generic_function(jl_function_t *f, jl_sym_t *name);
@@ -707,6 +714,8 @@ DLLEXPORT void jl_set_global(jl_module_t *m, jl_sym_t *var, jl_value_t *val);
 DLLEXPORT void jl_set_const(jl_module_t *m, jl_sym_t *var, jl_value_t *val);
 void jl_checked_assignment(jl_binding_t *b, jl_value_t *rhs);
 void jl_declare_constant(jl_binding_t *b);
+DLLEXPORT jl_binding_t *jl_resolve_global_slot(jl_binding_t **slot,
+                                               jl_module_t *m, jl_sym_t *var);
 jl_module_t *jl_add_module(jl_module_t *m, jl_module_t *child);
 jl_module_t *jl_get_module(jl_module_t *m, jl_sym_t *name);
 jl_module_t *jl_import_module(jl_module_t *to, jl_module_t *from);
@@ -731,10 +740,23 @@ jl_value_t *jl_interpret_toplevel_expr_with(jl_value_t *e,
                                             jl_value_t **locals, size_t nl);
 jl_value_t *jl_interpret_toplevel_expr_in(jl_module_t *m, jl_value_t *e,
                                           jl_value_t **locals, size_t nl);
+jl_value_t *jl_interpret_function(jl_function_t *f, jl_value_t **args,
+                                  uint32_t nargs);
+int jl_tiered_apply(jl_function_t *f, jl_value_t **args, uint32_t nargs,
+                    jl_value_t **presult);
+void jl_init_tiering(void);
+// optimization levels: 0 and 1 favor compile time, 2 is the default
+// pipeline, 3 adds more loop and redundancy elimination passes
+#define JL_MAX_OPT_LEVEL 3
+DLLEXPORT void jl_set_opt_level(int level);
+DLLEXPORT void jl_set_function_opt_level(jl_function_t *f, jl_tuple_t *sig,
+                                         int level);
+DLLEXPORT int jl_get_function_opt_level(jl_function_t *f, jl_tuple_t *sig);
 void jl_type_infer(jl_lambda_info_t *li, jl_tuple_t *argtypes,
                    jl_lambda_info_t *def);
 
 DLLEXPORT void jl_show_method_table(jl_function_t *gf);
+void jl_init_specialization_limit(void);
 jl_lambda_info_t *jl_add_static_parameters(jl_lambda_info_t *l, jl_tuple_t *sp);
 jl_function_t *jl_method_lookup_by_type(jl_methtable_t *mt, jl_tuple_t *types,
                                         int cache);
@@ -742,6 +764,21 @@ jl_function_t *jl_method_lookup(jl_methtable_t *mt, jl_value_t **args, size_t na
 jl_value_t *jl_gf_invoke(jl_function_t *gf, jl_tuple_t *types,
                          jl_value_t **args, size_t nargs);
 
+// inline cache for a dynamic call site. it has JL_IC_NENTRIES entries of
+// {world, func, argument types...}; an entry is valid while its world
+// equals jl_world_counter, which changes whenever a method definition
+// invalidates cached dispatch results.
+#define JL_IC_NENTRIES 4
+typedef struct {
+    size_t nargs;
+    void *data[1];
+} jl_callsite_t;
+#define jl_ic_entry(site,k) (&(site)->data[(k)*((site)->nargs+2)])
+extern size_t jl_world_counter;
+jl_callsite_t *jl_new_callsite(size_t nargs);
+jl_value_t *jl_apply_generic_ic(jl_value_t *F, jl_value_t **args,
+                                uint32_t nargs, jl_callsite_t *site);
+
 // AST access
 jl_array_t *jl_lam_args(jl_expr_t *l);
 jl_array_t *jl_lam_locals(jl_expr_t *l);
@@ -832,17 +869,36 @@ DLLEXPORT int jl_gc_is_enabled(void);
 void jl_gc_ephemeral_on(void);
 void jl_gc_ephemeral_off(void);
 DLLEXPORT void jl_gc_collect(void);
+DLLEXPORT void jl_gc_collect_minor(void);
 void jl_gc_preserve(jl_value_t *v);
 void jl_gc_unpreserve(void);
 int jl_gc_n_preserved_values(void);
 DLLEXPORT void jl_gc_add_finalizer(jl_value_t *v, jl_function_t *f);
 jl_weakref_t *jl_gc_new_weakref(jl_value_t *value);
-#define jl_gc_setmark(v) (((uptrint_t*)(v))[-1]|=1)
+void jl_gc_setmark(void *v);
 void jl_gc_acquire_buffer(void *b);
 void *alloc_2w(void);
 void *alloc_3w(void);
 void *alloc_4w(void);
 
+// write barrier, for generational collection. must follow any store of a
+// reference into an object that may already be old, unless the object is
+// a type, method table, lambda info, module or task.
+DLLEXPORT extern int jl_gc_generational;
+DLLEXPORT void jl_gc_set_generational(int on);
+DLLEXPORT void jl_gc_wb_slow(void *parent);
+DLLEXPORT void jl_gc_wb_array_slow(jl_array_t *a);
+#define jl_gc_wb(parent,ptr)                                    \
+    do { if (jl_gc_generational && (ptr) != NULL)               \
+            jl_gc_wb_slow(parent); } while (0)
+// for stores of unknown references, e.g. giving an array a new buffer
+#define jl_gc_wb_back(parent)                                   \
+    do { if (jl_gc_generational) jl_gc_wb_slow(parent); } while (0)
+// for stores into array elements
+#define jl_gc_wb_array(a,ptr)                                   \
+    do { if (jl_gc_generational && (ptr) != NULL)               \
+            jl_gc_wb_array_slow(a); } while (0)
+
 #else
 
 #define JL_GC_PUSH(...) ;
@@ -852,6 +908,9 @@ void *alloc_4w(void);
 #define jl_gc_preserve(v) ((void)(v))
 #define jl_gc_unpreserve()
 #define jl_gc_n_preserved_values() (0)
+#define jl_gc_wb(parent,ptr) ((void)0)
+#define jl_gc_wb_back(parent) ((void)0)
+#define jl_gc_wb_array(a,ptr) ((void)0)
 
 static inline void *alloc_2w() { return allocobj(2*sizeof(void*)); }
 static inline void *alloc_3w() { return allocobj(3*sizeof(void*)); }
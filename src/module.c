@@ -117,6 +117,19 @@ void jl_checked_assignment(jl_binding_t *b, jl_value_t *rhs)
     }
 }
 
+// resolve a global read by generated code that had no binding when the
+// code was compiled. the binding is remembered in *slot so later reads
+// skip the lookup.
+DLLEXPORT jl_binding_t *jl_resolve_global_slot(jl_binding_t **slot,
+                                               jl_module_t *m, jl_sym_t *var)
+{
+    jl_binding_t *b = jl_get_binding(m, var);
+    if (b == NULL || b->value == NULL)
+        jl_errorf("%s not defined", var->name);
+    *slot = b;
+    return b;
+}
+
 void jl_declare_constant(jl_binding_t *b)
 {
     if (b->value != NULL && !b->constp) {
@@ -436,6 +436,11 @@ static jl_value_t *build_backtrace(void)
     JL_GC_POP();
     return (jl_value_t*)a;
 }
+
+size_t jl_unw_stack(size_t *data, size_t maxsize)
+{
+    return backtrace((void**)data, maxsize);
+}
 #else
 // stacktrace using libunwind
 static jl_value_t *build_backtrace(void)
@@ -457,8 +462,36 @@ static jl_value_t *build_backtrace(void)
     JL_GC_POP();
     return (jl_value_t*)a;
 }
+
+size_t jl_unw_stack(size_t *data, size_t maxsize)
+{
+    unw_cursor_t cursor; unw_context_t uc;
+    unw_word_t ip;
+    size_t n=0;
+
+    unw_getcontext(&uc);
+    unw_init_local(&cursor, &uc);
+    while (n < maxsize && unw_step(&cursor)) {
+        unw_get_reg(&cursor, UNW_REG_IP, &ip);
+        data[n++] = ip;
+    }
+    return n;
+}
 #endif
 
+// turn return addresses from jl_unw_stack into (function, file, line)
+// triples, like build_backtrace
+jl_value_t *jl_decode_stack(size_t *data, size_t n)
+{
+    jl_array_t *a = jl_alloc_cell_1d(0);
+    size_t i;
+    JL_GC_PUSH(&a);
+    for(i=0; i < n; i++)
+        push_frame_info_from_ip(a, data[i]);
+    JL_GC_POP();
+    return (jl_value_t*)a;
+}
+
 DLLEXPORT void jl_register_toplevel_eh(void)
 {
     jl_current_task->state.eh_task->state.bt = 1;
@@ -89,3 +89,288 @@ let
     end
     @assert get_KeyError
 end
+
+# gc statistics
+let
+    s0 = gc_stats()
+    gc()
+    s1 = gc_stats()
+    @assert s1.collections == s0.collections+1
+    @assert s1.pause_max >= s1.recent_pauses[end]
+    @assert length(s1.pool_sizes) == length(s1.pool_live)
+    @assert s1.allocated >= s0.allocated
+end
+
+# allocation profiler
+let
+    alloc_profile_clear()
+    alloc_profile(1)
+    a = {}
+    for i=1:10
+        push(a, Array(Float64, i))
+    end
+    alloc_profile(0)
+    d = alloc_profile_data()
+    @assert length(d) > 0
+    @assert isa(d[1][2], Int)
+    alloc_profile_clear()
+    @assert length(alloc_profile_data()) == 0
+end
+
+# dispatch profiler
+let
+    dispatch_profile_clear()
+    dispatch_profile(true)
+    a = {1, 2.0, "x", 'c'}
+    for i=1:10
+        string(a[1+i%4])
+    end
+    dispatch_profile(false)
+    d = dispatch_profile_data()
+    @assert length(d) > 0
+    for (name, n, hits, misses, specs, t, widened) = d
+        @assert hits + misses <= n
+    end
+    dispatch_profile_clear()
+    @assert length(dispatch_profile_data()) == 0
+end
+
+# specialization limit
+_spec_f(x) = x
+let
+    (_, w0, lim) = specialization_stats()
+    specialization_limit(2)
+    for x = {1, 2.0, 'c', "s", int8(1), uint8(1)}
+        @assert is(_spec_f(x), x)
+    end
+    (_, w1, _) = specialization_stats()
+    specialization_limit(lim)
+    @assert w1 > w0
+end
+
+# subtype cache
+let
+    @assert subtype(Int32, Integer)
+    (h0, m0, _) = type_memo_stats()
+    @assert subtype(Int32, Integer)
+    @assert !subtype(Int32, Float)
+    @assert !subtype(Int32, Float)
+    (h1, m1, _) = type_memo_stats()
+    @assert h1 >= h0+2
+end
+
+# cache invalidation on new definitions
+_inv_f(x::Number) = 1
+_inv_f(x::String) = 3
+let
+    @assert _inv_f(1) == 1 && _inv_f(1.0) == 1 && _inv_f("s") == 3
+end
+_inv_f(x::Int) = 2
+let
+    @assert _inv_f(1) == 2 && _inv_f(1.0) == 1 && _inv_f("s") == 3
+end
+
+# invoke
+_ivk_f(x::Number) = 1
+_ivk_f(x::Int) = 2
+_ivk_g(x::Int) = invoke(_ivk_f, (Number,), x)
+let
+    @assert _ivk_f(1) == 2
+    @assert _ivk_g(1) == 1
+    @assert invoke(_ivk_f, (Number,), 1) == 1
+    @assert invoke(_ivk_f, (Int,), 1) == 2
+end
+
+# symbol interning
+let
+    syms = { gensym() | i=1:5000 }
+    @assert is(symbol(string(syms[1234])), syms[1234])
+    @assert is(symbol("sym_intern_test"), symbol("sym_intern_test"))
+end
+
+# globals bound after the code reading them was compiled
+_lazy_g() = _lazy_gv + 1
+let
+    caught = false
+    try
+        _lazy_g()
+    catch
+        caught = true
+    end
+    @assert caught
+end
+_lazy_gv = 1
+@assert _lazy_g() == 2
+_lazy_gv = 5
+@assert _lazy_g() == 6
+
+# tiered execution
+_tier_f(x) = tuple(x, x)
+let
+    (i0, p0, t) = tier_stats()
+    tier_threshold(3)
+    for x = {1, 2, 3, 4, 5}
+        @assert _tier_f(x) == (x, x)
+    end
+    (i1, p1, _) = tier_stats()
+    tier_threshold(t)
+    @assert i1 > i0
+    @assert p1 > p0
+end
+
+# functions that call intrinsics are always compiled
+_tier_g(x::Float64) = boxf64(add_float(x, x))
+let
+    t = tier_stats()[3]
+    tier_threshold(100)
+    (i0, _, _) = tier_stats()
+    a = _tier_g(1.0)
+    b = _tier_g(2.0)
+    (i1, _, _) = tier_stats()
+    tier_threshold(t)
+    @assert i1 == i0
+    @assert a == 2.0 && b == 4.0
+end
+
+# comprehensions get their element type from inference, which only compiled
+# code sees, so they are never interpreted either
+_tier_c() = [ i | i=1:3 ]
+let
+    t = tier_stats()[3]
+    tier_threshold(3)
+    (i0, _, _) = tier_stats()
+    for k = 1:5
+        @assert isa(_tier_c(), Array{Int,1})
+    end
+    (i1, _, _) = tier_stats()
+    tier_threshold(t)
+    @assert i1 == i0
+end
+
+# optimization levels
+@optimize function _opt_sum(n)
+    s = 0
+    for i = 1:n
+        s += i
+    end
+    s
+end
+let
+    l = optimization_level()
+    optimization_level(0)
+    @assert _opt_sum(100) == 5050
+    @assert optimization_level() == 0
+    optimization_level(l)
+end
+_opt_sum(x::Float64) = 2x
+@optimize _opt_first{T<:Real}(a::Array{T,1}, i...) = a[1]
+_opt_first(a) = a
+let
+    maxl = int(ccall(:jl_get_max_opt_level, Int32, ()))
+    @assert optimization_level(_opt_sum, (Any,)) == maxl
+    @assert optimization_level(_opt_sum, (Float64,)) == -1
+    T = typevar(:T, Real)
+    @assert optimization_level(_opt_first, (Array{T,1}, Any...)) == maxl
+    @assert optimization_level(_opt_first, (Any,)) == -1
+    @assert _opt_sum(1.5) == 3.0 && _opt_first([2,3], 1) == 2
+end
+
+# short vectors
+let
+    a = [1.0, 2.0, 3.0, 4.0, 5.0]
+    v = vecload(Float64x4, a, 2)
+    w = v + convert(Float64x4, 1.0)
+    @assert w[1] == 3.0 && w[4] == 6.0
+    @assert sum(v * v) == 54.0
+    m = v .< convert(Float64x4, 3.5)
+    @assert sum(blend(m, v, convert(Float64x4, 0.0))) == 5.0
+    vecstore(a, 1, w)
+    @assert a == [3.0, 4.0, 5.0, 6.0, 5.0]
+end
+
+# bounds check elimination
+function _bce_sum(a)
+    s = 0
+    for i = 1:length(a)
+        s += a[i]
+    end
+    s
+end
+function _bce_fill(a, x)
+    @inbounds for i = 1:length(a)
+        a[i] = x
+    end
+    a
+end
+@assert _bce_sum([1,2,3,4]) == 10
+@assert _bce_fill([0,0,0], 7) == [7,7,7]
+# a call that can resize the array keeps the checks, so reading past the
+# new end still raises the index out of range error
+_bce_shrink(a) = (pop(a); nothing)
+function _bce_sum_shrinking(a)
+    s = 0
+    for i = 1:length(a)
+        _bce_shrink(a)
+        s += a[i]
+    end
+    s
+end
+let
+    err = nothing
+    try
+        _bce_sum_shrinking([1,2,3,4])
+    catch e
+        err = e
+    end
+    @assert isa(err, ErrorException)
+end
+# only the builtin array length bounds the loop, not a method of length
+type _BceItem
+    x
+end
+length(a::Array{_BceItem,1}) = arraylen(a)+1
+function _bce_last(a)
+    s = nothing
+    for i = 1:length(a)
+        s = a[i]
+    end
+    s
+end
+let
+    a = Array(_BceItem, 2)
+    a[1] = _BceItem(1)
+    a[2] = _BceItem(2)
+    err = nothing
+    try
+        _bce_last(a)
+    catch e
+        err = e
+    end
+    @assert isa(err, ErrorException)
+end
+
+# generational gc: new objects stored into old arrays, old structs and
+# through a young reshaped view of an old array
+type _GenBox
+    x
+end
+let
+    gc_generational(true)
+    arr = {nothing, nothing, nothing, nothing}
+    own = {nothing, nothing, nothing, nothing}
+    obj = _GenBox(nothing)
+    gc(); gc()
+    arr[1] = string("a", 1)
+    obj.x = string("b", 2)
+    view = reshape(own, (2,2))
+    view[1] = string("c", 3)
+    view = nothing
+    for i = 1:4
+        gc_minor()
+        junk = { string(j) | j=1:200 }
+    end
+    @assert arr[1] == "a1"
+    @assert obj.x == "b2"
+    @assert own[1] == "c3"
+    gc_generational(false)
+end
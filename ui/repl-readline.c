@@ -354,47 +354,30 @@ static int common_prefix(const char *s1, const char *s2)
     return i;
 }
 
-static void symtab_search(jl_sym_t *tree, int *pcount, ios_t *result,
-                          const char *prefix, int plen)
+static int symtab_get_matches(const char *str, char **answer)
 {
-    do {
-        if (common_prefix(prefix, tree->name) == plen &&
-            jl_boundp(jl_system_module, tree)) {
-            ios_puts(tree->name, result);
-            ios_putc('\n', result);
-            (*pcount)++;
-        }
-        if (tree->left)
-            symtab_search(tree->left, pcount, result, prefix, plen);
-        tree = tree->right;
-    } while (tree != NULL);
-}
-
-static int symtab_get_matches(jl_sym_t *tree, const char *str, char **answer)
-{
-    int x, plen, count=0;
+    int count=0;
+    size_t i, sz, plen = strlen(str);
+    jl_sym_t **tab = jl_get_symtab(&sz);
     ios_t ans;
 
-    plen = strlen(str);
-
-    while (tree != NULL) {
-        x = common_prefix(str, tree->name);
-        if (x == plen) {
-            ios_mem(&ans, 0);
-            symtab_search(tree, &count, &ans, str, plen);
-            size_t nb;
-            *answer = ios_takebuf(&ans, &nb);
-            return count;
-        }
-        else {
-            x = strcmp(str, tree->name);
-            if (x < 0)
-                tree = tree->left;
-            else
-                tree = tree->right;
+    ios_mem(&ans, 0);
+    for(i=0; i < sz; i++) {
+        jl_sym_t *sym = tab[i];
+        if (sym != NULL && common_prefix(str, sym->name) == plen &&
+            jl_boundp(jl_system_module, sym)) {
+            ios_puts(sym->name, &ans);
+            ios_putc('\n', &ans);
+            count++;
         }
     }
-    return 0;
+    size_t nb;
+    *answer = ios_takebuf(&ans, &nb);
+    if (count == 0) {
+        free(*answer);
+        *answer = NULL;
+    }
+    return count;
 }
 
 int tab_complete(const char *line, char **answer, int *plen)
@@ -410,7 +393,7 @@ int tab_complete(const char *line, char **answer, int *plen)
     len++;
     *plen = len;
 
-    return symtab_get_matches(jl_get_root_symbol(), &line[len], answer);
+    return symtab_get_matches(&line[len], answer);
 }
 
 static char *strtok_saveptr;
@@ -21,7 +21,8 @@ static const char *opts =
     " -E --print=<expr>        Evaluate and show <expr>\n"
     " -P --post-boot=<expr>    Evaluate <expr> right after boot\n"
     " -L --load=file           Load <file> right after boot\n"
-    " -J --sysimage=file       Start up with the given system image file\n\n"
+    " -J --sysimage=file       Start up with the given system image file\n"
+    " -O --optimize=<level>    Set the code optimization level (0-3, default 2)\n\n"
 
     " -p n                     Run n local processes\n"
     " --machinefile file       Run processes on hosts listed in file\n\n"
@@ -29,7 +30,7 @@ static const char *opts =
     " -h --help                Print this message\n";
 
 void parse_opts(int *argcp, char ***argvp) {
-    static char* shortopts = "+H:T:bhJ:";
+    static char* shortopts = "+H:T:bhJ:O:";
     static struct option longopts[] = {
         { "home",        required_argument, 0, 'H' },
         { "tab",         required_argument, 0, 'T' },
@@ -37,6 +38,7 @@ void parse_opts(int *argcp, char ***argvp) {
         { "lisp",        no_argument,       &lisp_prompt, 1 },
         { "help",        no_argument,       0, 'h' },
         { "sysimage",    required_argument, 0, 'J' },
+        { "optimize",    required_argument, 0, 'O' },
         { 0, 0, 0, 0 }
     };
     int c;
@@ -65,6 +67,11 @@ void parse_opts(int *argcp, char ***argvp) {
             image_file = optarg;
             ind+=2;
             break;
+        case 'O':
+            jl_set_opt_level(atoi(optarg));
+            // -O2 and --optimize=2 take one word, -O 2 takes two
+            ind += (optarg == (*argvp)[optind-1]) ? 2 : 1;
+            break;
         case 'h':
             printf("%s%s", usage, opts);
             exit(0);